@@ -0,0 +1,101 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*! \file
+	\brief Counts the heap allocations of the process
+
+	Linking this file replaces the global operator new and delete, every allocation made through them is counted.
+*/
+
+#include "allocationcounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> g_allocationCount(0);
+
+/*! \returns the number of heap allocations made since the start of the process */
+size_t allocationCount()
+{
+	return g_allocationCount.load(std::memory_order_relaxed);
+}
+
+// all replaceable forms of new and delete are replaced, so every block is allocated and released by the same pair.
+// They live in their own translation unit, so the compiler cannot inline them and pair a free with a new.
+void* operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+
+void* operator new(size_t size)
+{
+	void *memory = operator new(size, std::nothrow);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void *memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+	operator delete(memory);
+}
@@ -0,0 +1,484 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*! \file
+	\brief End-to-end latency harness, from the UDP send of a datagram to its receipt from an LSL inlet
+
+	Runs the bridge in-process on a loopback port and sends it synthetic frames of one message type at a fixed
+	rate for every avatar, while an lsl::stream_inlet per avatar pulls the samples back out. Each frame carries
+	its number in its first values, so the latency of every sample is the time between sending the datagram and
+	pulling the sample, both taken from lsl::local_clock().
+
+	Every combination of the chosen message types, avatar counts and frame rates is one run. The runs and, per
+	message type and avatar count, the highest rate that was sustained without losing samples are written as
+	JSON, for comparison across builds.
+*/
+
+#include "lsl_cpp.h"
+#include "testsupport.h"
+#include "udpserver.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char HEXDIGITS[] = "0123456789ABCDEF";
+
+// the frame number carried in a frame wraps at this, far more frames than can be in flight
+static const int MARKERCOUNT = 65536;
+
+// frames sent before the measurement starts, while the outlets are created and the inlets connect
+static const double WARMUPTIME = 1.0;
+
+// the time given to samples still in flight after the last frame was sent
+static const double DRAINTIME = 0.5;
+
+static const double RESOLVETIMEOUT = 5.0;
+
+// the part of a frame period that is waited out by spinning, sleeping is too coarse for kHz rates
+static const std::chrono::microseconds SPINTIME(200);
+
+/*! A message type with an LSL outlet, and where its samples carry the frame number */
+struct Protocol
+{
+	int type;
+	const char *stream;		// the outlet name, without the avatar number
+	int recordCount;
+	int recordInts;			// the integer fields that start each record, such as the segment id
+	int recordFloats;
+	int markerChannel;		// a channel holding the frame number, after the bridge converted it
+	double markerScale;		// undoes the conversion of the marker channel
+};
+
+static const Protocol PROTOCOLS[] = {
+	{ 0x01, "EulerDatagram", 23, 1, 6, 0, 100.0 },
+	{ 0x02, "QuaternionDatagram", 23, 1, 7, 0, 1.0 },
+	{ 0x20, "JointAnglesDatagram", 22, 2, 3, 2, 1.0 },
+	{ 0x21, "LinearSegmentKinematicsDatagram", 23, 1, 9, 0, 1.0 },
+	{ 0x22, "AngularKinematics", 23, 1, 10, 0, M_PI / 180.0 },
+	{ 0x23, "TrackerKinematicsDatagram", 17, 1, 16, 0, 1.0 },
+	{ 0x24, "CenterOfMass", 1, 0, 3, 0, 1.0 },
+};
+
+/*! \returns the protocol of message \a type, or nullptr when it has no outlet */
+static const Protocol *findProtocol(int type)
+{
+	for (const Protocol &protocol : PROTOCOLS)
+		if (protocol.type == type)
+			return &protocol;
+	return nullptr;
+}
+
+/*! The command line settings */
+struct Settings
+{
+	Settings()
+		: port(9863), duration(3.0), lossLimit(0.001), output("loopback_latency.json")
+	{
+		for (const Protocol &protocol : PROTOCOLS)
+			types.push_back(protocol.type);
+		avatars = { 1, 4 };
+		rates = { 60, 240, 1000, 4000 };
+	}
+
+	int port;
+	double duration;
+	double lossLimit;
+	std::string output;
+	std::string label;
+	std::vector<int> types;
+	std::vector<int> avatars;
+	std::vector<double> rates;
+};
+
+/*! The outcome of sending one message type for a number of avatars at one rate */
+struct Result
+{
+	Result() : sent(0), received(0), overflow(0), datagramSize(0) {}
+
+	const Protocol *protocol;
+	int avatars;
+	double rate;
+	std::string error;
+	size_t sent;
+	size_t received;
+	size_t overflow;
+	size_t datagramSize;
+	std::vector<double> latencies;		// in seconds, sorted
+
+	double loss() const { return sent ? 1.0 - (double)received / sent : 0.0; }
+
+	/*! \returns true when the sender kept up with the rate for all avatars during \a duration seconds */
+	bool keptRate(double duration) const { return sent >= 0.99 * rate * avatars * duration; }
+
+	double percentile(double percent) const
+	{
+		if (latencies.empty())
+			return 0.0;
+		size_t index = (size_t)std::ceil(percent / 100.0 * latencies.size());
+		return latencies[index ? std::min(index, latencies.size()) - 1 : 0];
+	}
+
+	double mean() const
+	{
+		double sum = 0.0;
+		for (double latency : latencies)
+			sum += latency;
+		return latencies.empty() ? 0.0 : sum / latencies.size();
+	}
+};
+
+/*! One run of the harness: a bridge, a sender and an inlet per avatar */
+class LoopbackRun
+{
+public:
+	LoopbackRun(const Settings &settings, const Protocol &protocol, int avatars, double rate)
+		: m_settings(settings)
+		, m_protocol(protocol)
+		, m_avatars(avatars)
+		, m_rate(rate)
+		, m_sendTimes(avatars * MARKERCOUNT)
+		, m_measureStart(0.0)
+		, m_pulling(true)
+	{
+		for (std::atomic<double> &time : m_sendTimes)
+			time.store(0.0, std::memory_order_relaxed);
+		m_result.protocol = &protocol;
+		m_result.avatars = avatars;
+		m_result.rate = rate;
+	}
+
+	Result run()
+	{
+		std::unique_ptr<UdpServer> bridge(new UdpServer("127.0.0.1", (uint16_t)m_settings.port));
+
+		m_measureStart = lsl::local_clock() + WARMUPTIME;
+		std::thread sender(&LoopbackRun::send, this);
+
+		std::vector<std::unique_ptr<lsl::stream_inlet>> inlets;
+		for (int avatar = 0; avatar < m_avatars && m_result.error.empty(); avatar++)
+		{
+			std::string name = m_protocol.stream + std::to_string(avatar + 1);
+			std::vector<lsl::stream_info> streams = lsl::resolve_stream("name", name, 1, RESOLVETIMEOUT);
+			if (streams.empty())
+			{
+				m_result.error = "stream " + name + " not found";
+				break;
+			}
+			inlets.emplace_back(new lsl::stream_inlet(streams.front()));
+			inlets.back()->open_stream(RESOLVETIMEOUT);
+		}
+		if (m_result.error.empty() && lsl::local_clock() > m_measureStart)
+			m_result.error = "the inlets connected after the warm-up";
+
+		std::vector<std::vector<double>> latencies(inlets.size());
+		std::vector<std::thread> pullers;
+		for (size_t avatar = 0; avatar < inlets.size(); avatar++)
+			pullers.emplace_back(&LoopbackRun::pull, this, (int)avatar, inlets[avatar].get(), &latencies[avatar]);
+
+		sender.join();
+		std::this_thread::sleep_for(std::chrono::duration<double>(DRAINTIME));
+		m_pulling = false;
+		for (std::thread &puller : pullers)
+			puller.join();
+
+		m_result.overflow = bridge->queueOverflowCount();
+		inlets.clear();
+		bridge.reset();
+
+		for (const std::vector<double> &avatarLatencies : latencies)
+			m_result.latencies.insert(m_result.latencies.end(), avatarLatencies.begin(), avatarLatencies.end());
+		std::sort(m_result.latencies.begin(), m_result.latencies.end());
+		m_result.received = m_result.latencies.size();
+		return m_result;
+	}
+
+private:
+	/*! Send a frame for every avatar at the configured rate, until the measurement time is over */
+	void send()
+	{
+		int fd = socket(AF_INET, SOCK_DGRAM, 0);
+		int size = 4 * 1024 * 1024;
+		setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons((uint16_t)m_settings.port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		typedef std::chrono::steady_clock Clock;
+		Clock::time_point start = Clock::now();
+		std::chrono::duration<double> period(1.0 / m_rate);
+		double end = m_measureStart + m_settings.duration;
+		std::vector<uint8_t> datagram;
+
+		for (long frame = 0; ; frame++)
+		{
+			Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(period * frame);
+			if (due - Clock::now() > SPINTIME)
+				std::this_thread::sleep_until(due - SPINTIME);
+			while (Clock::now() < due)
+				;
+
+			double now = lsl::local_clock();
+			if (now >= end)
+				break;
+
+			int marker = (int)(frame % MARKERCOUNT);
+			for (int avatar = 0; avatar < m_avatars; avatar++)
+			{
+				build(datagram, frame, marker, avatar);
+				m_sendTimes[avatar * MARKERCOUNT + marker].store(lsl::local_clock(), std::memory_order_relaxed);
+				sendto(fd, datagram.data(), datagram.size(), 0, (const sockaddr*)&address, sizeof(address));
+				if (now >= m_measureStart)
+					m_result.sent++;
+			}
+		}
+		m_result.datagramSize = datagram.size();
+		close(fd);
+	}
+
+	/*! Build the datagram of \a frame for \a avatar, with \a marker in all its values */
+	void build(std::vector<uint8_t> &datagram, long frame, int marker, int avatar) const
+	{
+		PacketWriter writer(datagram);
+		writer.header(m_protocol.type, (int32_t)frame, 0x80, (uint8_t)m_protocol.recordCount,
+			(int32_t)(frame * 1000 / m_rate), (uint8_t)avatar);
+
+		for (int record = 0; record < m_protocol.recordCount; record++)
+		{
+			for (int i = 0; i < m_protocol.recordInts; i++)
+				writer.int32((record + 1) * 256 + i);
+			for (int i = 0; i < m_protocol.recordFloats; i++)
+				writer.float32((float)marker);
+		}
+	}
+
+	/*! Pull the samples of \a avatar and collect the latencies of the ones sent during the measurement */
+	void pull(int avatar, lsl::stream_inlet *inlet, std::vector<double> *latencies)
+	{
+		std::vector<float> sample;
+		while (m_pulling)
+		{
+			if (inlet->pull_sample(sample, 0.1) == 0.0)
+				continue;
+			double now = lsl::local_clock();
+
+			if ((size_t)m_protocol.markerChannel >= sample.size())
+				continue;
+			long marker = std::lround(std::fabs(sample[m_protocol.markerChannel]) * m_protocol.markerScale);
+			double sent = m_sendTimes[avatar * MARKERCOUNT + marker % MARKERCOUNT].load(std::memory_order_relaxed);
+			if (sent >= m_measureStart)
+				latencies->push_back(now - sent);
+		}
+	}
+
+	const Settings &m_settings;
+	const Protocol &m_protocol;
+	int m_avatars;
+	double m_rate;
+	std::vector<std::atomic<double>> m_sendTimes;
+	double m_measureStart;
+	std::atomic<bool> m_pulling;
+	Result m_result;
+};
+
+/*! \returns the comma separated values of \a list */
+template <class T>
+static std::vector<T> parseList(const char *list, int base = 10)
+{
+	std::vector<T> values;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ','))
+		if (!item.empty())
+			values.push_back(base == 16 ? (T)strtol(item.c_str(), nullptr, 16) : (T)atof(item.c_str()));
+	return values;
+}
+
+static void usage(const char *program)
+{
+	std::cout << "Usage: " << program << " [options]\n"
+		<< "  --types LIST       hexadecimal message types, default all types with an outlet (01,02,20,21,22,23,24)\n"
+		<< "  --avatars LIST     avatar counts, default 1,4\n"
+		<< "  --rates LIST       frame rates in Hz, default 60,240,1000,4000\n"
+		<< "  --duration SEC     measurement time of every run, default 3\n"
+		<< "  --loss-limit FRAC  the sample loss a rate is still sustained at, default 0.001\n"
+		<< "  --port PORT        loopback UDP port of the bridge, default 9863\n"
+		<< "  --label TEXT       identifies the build in the output\n"
+		<< "  --output FILE      JSON output, default loopback_latency.json\n";
+}
+
+/*! \returns \a type as two hexadecimal digits */
+static std::string typeName(int type)
+{
+	return std::string(1, HEXDIGITS[(type >> 4) & 0xF]) + HEXDIGITS[type & 0xF];
+}
+
+/*! Writes the results as JSON */
+static void writeResults(std::ostream &out, const Settings &settings, const std::vector<Result> &results)
+{
+	out << std::setprecision(9);
+	out << "{\n\t\"label\": \"" << settings.label << "\",\n"
+		<< "\t\"duration\": " << settings.duration << ",\n"
+		<< "\t\"loss_limit\": " << settings.lossLimit << ",\n"
+		<< "\t\"runs\": [";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result &r = results[i];
+		out << (i ? "," : "") << "\n\t\t{ \"type\": \"" << typeName(r.protocol->type) << "\", \"stream\": \"" << r.protocol->stream << "\""
+			<< ", \"avatars\": " << r.avatars << ", \"rate\": " << r.rate
+			<< ", \"error\": \"" << r.error << "\""
+			<< ", \"datagram_bytes\": " << r.datagramSize
+			<< ", \"sent\": " << r.sent << ", \"kept_rate\": " << (r.keptRate(settings.duration) ? "true" : "false")
+			<< ", \"received\": " << r.received << ", \"loss\": " << r.loss()
+			<< ", \"queue_overflow\": " << r.overflow
+			<< ", \"throughput\": " << r.received / settings.duration
+			<< ", \"latency_us\": { \"mean\": " << r.mean() * 1e6
+			<< ", \"p50\": " << r.percentile(50) * 1e6 << ", \"p90\": " << r.percentile(90) * 1e6
+			<< ", \"p99\": " << r.percentile(99) * 1e6 << ", \"p99.9\": " << r.percentile(99.9) * 1e6
+			<< ", \"max\": " << r.percentile(100) * 1e6 << " } }";
+	}
+	out << "\n\t],\n\t\"sustained\": [";
+
+	// the highest rate of every type and avatar count that was sent in full and received within the loss limit
+	bool first = true;
+	for (int type : settings.types)
+	{
+		for (int avatars : settings.avatars)
+		{
+			double sustained = 0.0;
+			for (const Result &r : results)
+				if (r.protocol->type == type && r.avatars == avatars && r.error.empty() &&
+						r.keptRate(settings.duration) && r.loss() <= settings.lossLimit)
+					sustained = std::max(sustained, r.rate);
+
+			out << (first ? "" : ",") << "\n\t\t{ \"type\": \"" << typeName(type) << "\", \"avatars\": " << avatars
+				<< ", \"rate\": " << sustained << " }";
+			first = false;
+		}
+	}
+	out << "\n\t]\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+	Settings settings;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--types" && hasValue)
+			settings.types = parseList<int>(argv[++i], 16);
+		else if (arg == "--avatars" && hasValue)
+			settings.avatars = parseList<int>(argv[++i]);
+		else if (arg == "--rates" && hasValue)
+			settings.rates = parseList<double>(argv[++i]);
+		else if (arg == "--duration" && hasValue)
+			settings.duration = atof(argv[++i]);
+		else if (arg == "--loss-limit" && hasValue)
+			settings.lossLimit = atof(argv[++i]);
+		else if (arg == "--port" && hasValue)
+			settings.port = atoi(argv[++i]);
+		else if (arg == "--label" && hasValue)
+			settings.label = argv[++i];
+		else if (arg == "--output" && hasValue)
+			settings.output = argv[++i];
+		else
+		{
+			usage(argv[0]);
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	for (int type : settings.types)
+	{
+		if (!findProtocol(type))
+		{
+			std::cout << "Message type " << std::hex << type << std::dec << " has no outlet" << std::endl;
+			return 1;
+		}
+	}
+	if (settings.duration <= 0 || settings.avatars.empty() || settings.rates.empty())
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<Result> results;
+	for (int type : settings.types)
+	{
+		for (int avatars : settings.avatars)
+		{
+			for (double rate : settings.rates)
+			{
+				if (avatars < 1 || avatars > 255 || rate <= 0)
+					continue;
+
+				const Protocol &protocol = *findProtocol(type);
+				results.push_back(LoopbackRun(settings, protocol, avatars, rate).run());
+
+				const Result &r = results.back();
+				std::cout << protocol.stream << ", " << avatars << " avatars at " << rate << " Hz: ";
+				if (!r.error.empty())
+					std::cout << r.error << std::endl;
+				else
+					std::cout << r.received << "/" << r.sent << " samples, latency p50 "
+						<< r.percentile(50) * 1e6 << " us, p99 " << r.percentile(99) * 1e6 << " us, max "
+						<< r.percentile(100) * 1e6 << " us" << std::endl;
+			}
+		}
+	}
+
+	std::ofstream file(settings.output);
+	if (!file)
+	{
+		std::cout << "Unable to write " << settings.output << std::endl;
+		return 1;
+	}
+	writeResults(file, settings, results);
+	std::cout << "Results written to " << settings.output << std::endl;
+	return 0;
+}
@@ -0,0 +1,287 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*! \file
+	\brief Microbenchmarks of the datagram parsers
+
+	Every datagram class is fed a canned packet of a typical size: 23 segments, 17 trackers and 22 joints. The
+	benchmarks report the time per packet, the payload bytes per second and the heap allocations per packet, as a
+	baseline for parser optimizations.
+
+	Deserialize covers the header and the payload, DeserializeData the payload alone. The outlets of the datagrams
+	are not published, so no LSL streams are created and liblsl is not part of the measurement. The records are converted
+	while they are decoded, so DecodeRecords times the decode kernels without the datagram around them, and the
+	conversion of the Euler datagram is the difference between its DeserializeData and the unconverted decode of
+	the same record size.
+*/
+
+#include "allocationcounter.h"
+#include "angularsegmentkinematicsdatagram.h"
+#include "centerofmassdatagram.h"
+#include "datagramheader.h"
+#include "eulerdatagram.h"
+#include "jointanglesdatagram.h"
+#include "linearsegmentkinematicsdatagram.h"
+#include "metadatagram.h"
+#include "positiondatagram.h"
+#include "quaterniondatagram.h"
+#include "recordlayout.h"
+#include "scaledatagram.h"
+#include "testsupport.h"
+#include "timecodedatagram.h"
+#include "trackerkinematicsdatagram.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+static const int SEGMENTS = 23;
+static const int TRACKERS = 17;
+static const int JOINTS = 22;
+
+/*! Append \a count float values to the packet of \a writer */
+void writeFloats(PacketWriter &writer, int count)
+{
+	for (int i = 0; i < count; i++)
+		writer.float32(0.25f * (i + 1));
+}
+
+/*! \returns a packet of \a type with a header for \a dataCount items */
+std::vector<uint8_t> header(int type, int dataCount)
+{
+	std::vector<uint8_t> packet;
+	PacketWriter(packet).header(type, 1, 0x80, (uint8_t)dataCount, 1000, 0);
+	return packet;
+}
+
+/*! \returns a packet of \a type with \a count records of a segment id and \a floats values */
+std::vector<uint8_t> segmentPacket(int type, int count, int floats)
+{
+	std::vector<uint8_t> packet = header(type, count);
+	PacketWriter writer(packet);
+	for (int i = 0; i < count; i++)
+	{
+		writer.int32(i + 1);
+		writeFloats(writer, floats);
+	}
+	return packet;
+}
+
+/*! \returns the canned packet of \a type */
+std::vector<uint8_t> cannedPacket(int type)
+{
+	switch (type)
+	{
+	case SPPoseEuler:					return segmentPacket(type, SEGMENTS, 6);
+	case SPPoseQuaternion:				return segmentPacket(type, SEGMENTS, 7);
+	case SPPosePositions:				return segmentPacket(type, SEGMENTS, 3);
+	case SPLinearSegmentKinematics:		return segmentPacket(type, SEGMENTS, 9);
+	case SPAngularSegmentKinematics:	return segmentPacket(type, SEGMENTS, 10);
+	case SPTrackerKinematics:			return segmentPacket(type, TRACKERS, 16);
+	case SPJointAngles:
+	{
+		std::vector<uint8_t> packet = header(type, JOINTS);
+		PacketWriter writer(packet);
+		for (int i = 0; i < JOINTS; i++)
+		{
+			writer.int32((i + 1) * 256 + 1);
+			writer.int32((i + 2) * 256);
+			writeFloats(writer, 3);
+		}
+		return packet;
+	}
+	case SPCenterOfMass:
+	{
+		std::vector<uint8_t> packet = header(type, 1);
+		PacketWriter writer(packet);
+		writeFloats(writer, 3);
+		return packet;
+	}
+	case SPTimeCode:
+	{
+		std::vector<uint8_t> packet = header(type, 1);
+		PacketWriter(packet).string("01:02:03.456");
+		return packet;
+	}
+	case SPMetaMoreMeta:
+	{
+		std::vector<uint8_t> packet = header(type, 1);
+		PacketWriter(packet).string("name:Benchmark\ncolor:ff0000\n");
+		return packet;
+	}
+	case SPMetaScaling:
+	{
+		std::vector<uint8_t> packet = header(type, 1);
+		PacketWriter writer(packet);
+		writer.int32(SEGMENTS);
+		for (int i = 0; i < SEGMENTS; i++)
+		{
+			writer.string("Segment" + std::to_string(i + 1));
+			writeFloats(writer, 3);
+		}
+		return packet;
+	}
+	default:
+		return header(type, 0);
+	}
+}
+
+/*! Gives the benchmarks access to the payload parser of datagram class \a T */
+template <class T>
+struct Exposed : public T
+{
+	using T::deserializeData;
+};
+
+/*! Makes the field transforms of the record layouts available to the benchmarks */
+struct Transforms : public Datagram
+{
+	typedef Datagram::PositionScale PositionScale;
+	typedef Datagram::YupToZup YupToZup;
+	typedef Datagram::Rad2Deg Rad2Deg;
+};
+
+/*! Keep the outlets of \a datagram off the network, the benchmarks only use their sample buffers */
+void unpublish(Datagram &datagram)
+{
+	if (OutletRegistry *outlets = datagram.outlets())
+		outlets->setPublishing(false);
+}
+
+/*! Report the \a bytes processed per packet and the allocations made since \a allocations */
+void report(benchmark::State &state, size_t bytes, size_t allocations)
+{
+	state.SetBytesProcessed((int64_t)(state.iterations() * bytes));
+	state.SetItemsProcessed((int64_t)state.iterations());
+	state.counters["allocs/packet"] = benchmark::Counter(
+		(double)(allocationCount() - allocations), benchmark::Counter::kAvgIterations);
+}
+
+}
+
+static void BM_MessageType(benchmark::State &state)
+{
+	std::vector<uint8_t> packet = cannedPacket(SPPoseQuaternion);
+	size_t allocations = allocationCount();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(Datagram::messageType(packet.data(), packet.size()));
+	report(state, DatagramHeader::SIZE, allocations);
+}
+BENCHMARK(BM_MessageType);
+
+/*! Parse the canned packet of \a Type, header and payload */
+template <class T, int Type>
+static void BM_Deserialize(benchmark::State &state)
+{
+	T datagram;
+	unpublish(datagram);
+	std::vector<uint8_t> packet = cannedPacket(Type);
+
+	// the first packet creates the outlet buffers that the following ones reuse
+	datagram.deserialize(packet.data(), packet.size());
+
+	size_t allocations = allocationCount();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(datagram.deserialize(packet.data(), packet.size()));
+	report(state, packet.size(), allocations);
+}
+
+/*! Parse the payload of the canned packet of \a Type */
+template <class T, int Type>
+static void BM_DeserializeData(benchmark::State &state)
+{
+	Exposed<T> datagram;
+	unpublish(datagram);
+	std::vector<uint8_t> packet = cannedPacket(Type);
+	datagram.deserialize(packet.data(), packet.size());
+
+	const uint8_t *payload = packet.data() + DatagramHeader::SIZE;
+	size_t payloadSize = packet.size() - DatagramHeader::SIZE;
+
+	size_t allocations = allocationCount();
+	for (auto _ : state)
+	{
+		Streamer streamer(payload, payloadSize);
+		benchmark::DoNotOptimize(datagram.deserializeData(streamer));
+	}
+	report(state, payloadSize, allocations);
+}
+
+#define DATAGRAM_BENCHMARKS(Class, Type) \
+	BENCHMARK_TEMPLATE(BM_Deserialize, Class, Type); \
+	BENCHMARK_TEMPLATE(BM_DeserializeData, Class, Type)
+
+DATAGRAM_BENCHMARKS(EulerDatagram, SPPoseEuler);
+DATAGRAM_BENCHMARKS(QuaternionDatagram, SPPoseQuaternion);
+DATAGRAM_BENCHMARKS(PositionDatagram, SPPosePositions);
+DATAGRAM_BENCHMARKS(MetaDatagram, SPMetaMoreMeta);
+DATAGRAM_BENCHMARKS(ScaleDatagram, SPMetaScaling);
+DATAGRAM_BENCHMARKS(JointAnglesDatagram, SPJointAngles);
+DATAGRAM_BENCHMARKS(LinearSegmentKinematicsDatagram, SPLinearSegmentKinematics);
+DATAGRAM_BENCHMARKS(AngularSegmentKinematicsDatagram, SPAngularSegmentKinematics);
+DATAGRAM_BENCHMARKS(TrackerKinematicsDatagram, SPTrackerKinematics);
+DATAGRAM_BENCHMARKS(CenterOfMassDatagram, SPCenterOfMass);
+DATAGRAM_BENCHMARKS(TimeCodeDatagram, SPTimeCode);
+
+/*! Decode SEGMENTS records of \a Layout from a packet of matching size, without a datagram around it */
+template <class Layout>
+static void BM_DecodeRecords(benchmark::State &state)
+{
+	std::vector<uint8_t> packet = segmentPacket(SPPoseQuaternion, SEGMENTS, (int)Layout::words() - 1);
+	const uint8_t *payload = packet.data() + DatagramHeader::SIZE;
+	std::vector<float> sample(SEGMENTS * Layout::channels());
+
+	size_t allocations = allocationCount();
+	for (auto _ : state)
+	{
+		Streamer streamer(payload, SEGMENTS * Layout::size());
+		streamer.readLayout<Layout>(sample.data(), SEGMENTS);
+		benchmark::DoNotOptimize(sample.data());
+		benchmark::ClobberMemory();
+	}
+	report(state, SEGMENTS * Layout::size(), allocations);
+}
+
+// the layout of the quaternion datagram without its conversion
+typedef RecordLayout::Record<RecordLayout::Skip<1>, RecordLayout::Float<7>> RawQuaternion;
+BENCHMARK_TEMPLATE(BM_DecodeRecords, RawQuaternion);
+
+// the record size of the Euler datagram, without and with the conversion of its position
+typedef RecordLayout::Record<RecordLayout::Skip<1>, RecordLayout::Float<6>> RawEuler;
+typedef RecordLayout::Record<RecordLayout::Skip<1>,
+	RecordLayout::Float<3, RecordLayout::Chain<Transforms::PositionScale, Transforms::YupToZup>>,
+	RecordLayout::Float<3>> ConvertedEulerPosition;
+BENCHMARK_TEMPLATE(BM_DecodeRecords, RawEuler);
+BENCHMARK_TEMPLATE(BM_DecodeRecords, ConvertedEulerPosition);
+
+// the widest record, the tracker kinematics
+typedef RecordLayout::Record<RecordLayout::Skip<1>, RecordLayout::Float<16>> RawTracker;
+BENCHMARK_TEMPLATE(BM_DecodeRecords, RawTracker);
+
+BENCHMARK_MAIN();
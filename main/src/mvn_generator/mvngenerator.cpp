@@ -0,0 +1,536 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*! \file
+	\brief A synthetic MVN Studio network streamer
+
+	Sends valid MXTP datagrams of every message type the bridge parses to a UDP port, for load and regression
+	testing without a suit and an MVN Studio license. The avatar, segment and tracker counts, the frame rate,
+	the fragmentation of large frames and the loss and reordering of datagrams can be chosen on the command line.
+*/
+
+#include "testsupport.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the largest payload of a UDP datagram over IPv4
+static const size_t MAXDATAGRAMSIZE = 65507;
+
+
+// the last part of a frame, and the only part of a frame that is not split
+static const uint8_t LASTPART = 0x80;
+
+// the part of a frame period that is waited out by spinning, sleeping is too coarse for kHz rates
+static const std::chrono::microseconds SPINTIME(200);
+
+// the character meta data and the segment names are repeated this often, as MVN Studio does
+static const double METAINTERVAL = 1.0;
+
+// the message types in the order they are sent each frame
+static const int ALLTYPES[] = { 0x01, 0x02, 0x03, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25 };
+
+static volatile sig_atomic_t g_quit = 0;
+
+static void handleSignal(int)
+{
+	g_quit = 1;
+}
+
+/*! The command line settings */
+struct Settings
+{
+	Settings()
+		: host("127.0.0.1"), port(9763), avatars(1), segments(23), trackers(17), rate(60), frames(0)
+		, mtu(0), loss(0), reorder(0), seed(1)
+	{
+		types.assign(ALLTYPES, ALLTYPES + sizeof(ALLTYPES) / sizeof(ALLTYPES[0]));
+	}
+
+	std::string host;
+	int port;
+	int avatars;
+	int segments;
+	int trackers;
+	double rate;
+	long frames;
+	size_t mtu;
+	double loss;
+	double reorder;
+	unsigned int seed;
+	std::vector<int> types;
+};
+
+/*! Sends datagrams, dropping and reordering them as configured */
+class Sender
+{
+public:
+	Sender(const Settings &settings)
+		: m_socket(socket(AF_INET, SOCK_DGRAM, 0))
+		, m_random(settings.seed)
+		, m_loss(settings.loss)
+		, m_reorder(settings.reorder)
+		, m_held(false)
+		, m_sentCount(0)
+		, m_droppedCount(0)
+		, m_reorderedCount(0)
+	{
+		memset(&m_address, 0, sizeof(m_address));
+		m_address.sin_family = AF_INET;
+		m_address.sin_port = htons((uint16_t)settings.port);
+		inet_pton(AF_INET, settings.host.c_str(), &m_address.sin_addr);
+
+		// bursts of large frames at kHz rates overflow the default send buffer
+		int size = 4 * 1024 * 1024;
+		setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+	}
+
+	~Sender()
+	{
+		flush();
+		close(m_socket);
+	}
+
+	bool isOpen() const { return m_socket >= 0; }
+
+	/*! Send \a datagram, or drop it, or hold it back until after the next one */
+	void send(const std::vector<uint8_t> &datagram)
+	{
+		if (m_loss > 0 && m_uniform(m_random) < m_loss)
+		{
+			m_droppedCount++;
+			return;
+		}
+
+		if (!m_held && m_reorder > 0 && m_uniform(m_random) < m_reorder)
+		{
+			m_heldDatagram = datagram;
+			m_held = true;
+			m_reorderedCount++;
+			return;
+		}
+
+		transmit(datagram);
+		flush();
+	}
+
+	/*! Send the datagram that is held back */
+	void flush()
+	{
+		if (!m_held)
+			return;
+		m_held = false;
+		transmit(m_heldDatagram);
+	}
+
+	size_t sentCount() const { return m_sentCount; }
+	size_t droppedCount() const { return m_droppedCount; }
+	size_t reorderedCount() const { return m_reorderedCount; }
+
+private:
+	void transmit(const std::vector<uint8_t> &datagram)
+	{
+		if (sendto(m_socket, datagram.data(), datagram.size(), 0, (const sockaddr*)&m_address, sizeof(m_address)) >= 0)
+			m_sentCount++;
+	}
+
+	int m_socket;
+	sockaddr_in m_address;
+	std::mt19937 m_random;
+	std::uniform_real_distribution<double> m_uniform;
+	double m_loss;
+	double m_reorder;
+	bool m_held;
+	std::vector<uint8_t> m_heldDatagram;
+	size_t m_sentCount;
+	size_t m_droppedCount;
+	size_t m_reorderedCount;
+};
+
+/*! Builds the datagrams of every frame */
+class Generator
+{
+public:
+	Generator(const Settings &settings, Sender &sender)
+		: m_settings(settings)
+		, m_sender(sender)
+	{
+	}
+
+	/*! Send all datagrams of frame \a sampleCounter, captured \a frameTime milliseconds after the start */
+	void sendFrame(int32_t sampleCounter, int32_t frameTime, bool sendMeta)
+	{
+		double t = frameTime * 1e-3;
+		for (int avatar = 0; avatar < m_settings.avatars; avatar++)
+		{
+			if (sendMeta)
+			{
+				sendMetaData(avatar, sampleCounter, frameTime);
+				sendScaling(avatar, sampleCounter, frameTime);
+			}
+
+			for (int type : m_settings.types)
+			{
+				buildRecords(type, avatar, t);
+				sendRecords(type, avatar, sampleCounter, frameTime);
+			}
+		}
+	}
+
+private:
+	/*! Fill the record buffer with the records of \a type of \a avatar at \a t seconds */
+	void buildRecords(int type, int avatar, double t)
+	{
+		m_records.clear();
+		m_recordSizes.clear();
+		int segments = m_settings.segments;
+
+		switch (type)
+		{
+		case 0x01:		// position and Euler rotation, Y-Up in cm and degrees
+			for (int i = 0; i < segments; i++)
+				record(i + 1, 6, avatar, t, 100.0f);
+			break;
+		case 0x02:		// position and quaternion rotation
+			for (int i = 0; i < segments; i++)
+				quaternionRecord(i, avatar, t);
+			break;
+		case 0x03:		// virtual markers
+			for (int i = 0; i < segments; i++)
+				record(i + 1, 3, avatar, t, 1.0f);
+			break;
+		case 0x20:		// joint angles, between consecutive segments
+			for (int i = 0; i + 1 < segments; i++)
+			{
+				size_t start = m_records.size();
+				PacketWriter writer(m_records);
+				writer.int32((i + 1) * 256 + 1);
+				writer.int32((i + 2) * 256);
+				values(writer, 3, avatar * 100 + i, t, 30.0f);
+				m_recordSizes.push_back(m_records.size() - start);
+			}
+			break;
+		case 0x21:		// position, velocity and acceleration
+			for (int i = 0; i < segments; i++)
+				record(i + 1, 9, avatar, t, 1.0f);
+			break;
+		case 0x22:		// orientation, angular velocity and acceleration
+			for (int i = 0; i < segments; i++)
+				record(i + 1, 10, avatar, t, 1.0f);
+			break;
+		case 0x23:		// sensor orientation, free acceleration, acceleration, gyroscope and magnetometer
+			for (int i = 0; i < m_settings.trackers; i++)
+				record(i + 1, 16, avatar, t, 1.0f);
+			break;
+		case 0x24:		// center of mass, a single record without an id
+		{
+			PacketWriter writer(m_records);
+			values(writer, 3, avatar, t, 1.0f);
+			m_recordSizes.push_back(m_records.size());
+			break;
+		}
+		case 0x25:		// time code string HH:MM:SS.mmm
+		{
+			long ms = (long)(t * 1000.0);
+			char timeCode[32];
+			snprintf(timeCode, sizeof(timeCode), "%02ld:%02ld:%02ld.%03ld",
+				(ms / 3600000) % 24, (ms / 60000) % 60, (ms / 1000) % 60, ms % 1000);
+			PacketWriter(m_records).string(timeCode);
+			m_recordSizes.push_back(m_records.size());
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	/*! A record of a segment \a id followed by \a count values */
+	void record(int32_t id, int count, int avatar, double t, float scale)
+	{
+		size_t start = m_records.size();
+		PacketWriter writer(m_records);
+		writer.int32(id);
+		values(writer, count, avatar * 100 + id, t, scale);
+		m_recordSizes.push_back(m_records.size() - start);
+	}
+
+	/*! A record of segment \a index with a position and a normalized quaternion */
+	void quaternionRecord(int index, int avatar, double t)
+	{
+		size_t start = m_records.size();
+		PacketWriter writer(m_records);
+		writer.int32(index + 1);
+		values(writer, 3, avatar * 100 + index, t, 1.0f);
+		double angle = t + index * 0.1;
+		writer.float32((float)std::cos(angle / 2));
+		writer.float32((float)std::sin(angle / 2));
+		writer.float32(0.0f);
+		writer.float32(0.0f);
+		m_recordSizes.push_back(m_records.size() - start);
+	}
+
+	/*! \a count slowly varying values, different for every \a seed */
+	static void values(PacketWriter &writer, int count, int seed, double t, float scale)
+	{
+		for (int i = 0; i < count; i++)
+			writer.float32(scale * (float)std::sin(t * (1.0 + 0.1 * i) + seed));
+	}
+
+	/*! Send the records of \a type, split over as many datagrams as the MTU requires */
+	void sendRecords(int type, int avatar, int32_t sampleCounter, int32_t frameTime)
+	{
+		size_t limit = m_settings.mtu > PacketWriter::HEADERSIZE
+			? m_settings.mtu - PacketWriter::HEADERSIZE : MAXDATAGRAMSIZE - PacketWriter::HEADERSIZE;
+		size_t record = 0, offset = 0;
+		int part = 0;
+
+		while (record < m_recordSizes.size())
+		{
+			// every part has at least one record, a record larger than the limit goes out whole
+			size_t first = record, size = 0;
+			while (record < m_recordSizes.size() && (record == first || size + m_recordSizes[record] <= limit))
+				size += m_recordSizes[record++];
+
+			bool last = record == m_recordSizes.size();
+			header(type, sampleCounter, (uint8_t)(part | (last ? LASTPART : 0)), (uint8_t)(record - first),
+				frameTime, avatar);
+			m_datagram.insert(m_datagram.end(), m_records.begin() + offset, m_records.begin() + offset + size);
+			m_sender.send(m_datagram);
+
+			offset += size;
+			part++;
+		}
+	}
+
+	/*! Start the datagram buffer with a header */
+	void header(int type, int32_t sampleCounter, uint8_t datagramCounter, uint8_t dataCount, int32_t frameTime, int avatar)
+	{
+		PacketWriter(m_datagram).header(type, sampleCounter, datagramCounter, dataCount, frameTime, (uint8_t)avatar);
+	}
+
+	/*! Send the character meta data of \a avatar */
+	void sendMetaData(int avatar, int32_t sampleCounter, int32_t frameTime)
+	{
+		header(0x12, sampleCounter, LASTPART, 1, frameTime, avatar);
+		PacketWriter(m_datagram).string("name:Generated" + std::to_string(avatar + 1) + "\ncolor:ff0000\n");
+		m_sender.send(m_datagram);
+	}
+
+	/*! Send the null pose of the segments of \a avatar, which names the segments */
+	void sendScaling(int avatar, int32_t sampleCounter, int32_t frameTime)
+	{
+		header(0x13, sampleCounter, LASTPART, 1, frameTime, avatar);
+		PacketWriter writer(m_datagram);
+		writer.int32(m_settings.segments);
+		for (int i = 0; i < m_settings.segments; i++)
+		{
+			writer.string("Segment" + std::to_string(i + 1));
+			writer.float32(0.0f);
+			writer.float32(0.0f);
+			writer.float32(0.1f * i);
+		}
+		m_sender.send(m_datagram);
+
+		// like MVN Studio, follow the null pose with the point definitions in packets of 0 segments,
+		// a point of every segment and then a last packet without points
+		header(0x13, sampleCounter, LASTPART, 1, frameTime, avatar);
+		PacketWriter points(m_datagram);
+		points.int32(0);
+		points.int32(m_settings.segments);
+		for (int i = 0; i < m_settings.segments; i++)
+		{
+			points.int16((int16_t)(i + 1));
+			points.int16(0);
+			points.string("pSegment" + std::to_string(i + 1));
+			points.int32(0);
+			points.float32(0.0f);
+			points.float32(0.05f);
+			points.float32(0.0f);
+		}
+		m_sender.send(m_datagram);
+
+		header(0x13, sampleCounter, LASTPART, 1, frameTime, avatar);
+		PacketWriter last(m_datagram);
+		last.int32(0);
+		last.int32(0);
+		m_sender.send(m_datagram);
+	}
+
+	const Settings &m_settings;
+	Sender &m_sender;
+
+	// the records of the current message type, the size of each, and the datagram being sent
+	std::vector<uint8_t> m_records;
+	std::vector<size_t> m_recordSizes;
+	std::vector<uint8_t> m_datagram;
+};
+
+static void printUsage(const char *program)
+{
+	std::cout << "Usage: " << program << " [options]" << std::endl
+		<< "  --host address        destination address (127.0.0.1)" << std::endl
+		<< "  --port port           destination port (9763)" << std::endl
+		<< "  --avatars count       number of avatars (1)" << std::endl
+		<< "  --segments count      segments per avatar (23)" << std::endl
+		<< "  --trackers count      trackers per avatar (17)" << std::endl
+		<< "  --rate hz             frames per second (60)" << std::endl
+		<< "  --frames count        stop after this many frames, 0 runs until interrupted (0)" << std::endl
+		<< "  --types type[,type]   hexadecimal message types to send (01,02,03,20,21,22,23,24,25)" << std::endl
+		<< "  --mtu bytes           split frames into datagrams of at most this size, 0 does not split (0)" << std::endl
+		<< "  --loss percent        drop this share of the datagrams (0)" << std::endl
+		<< "  --reorder percent     send this share of the datagrams after the next one (0)" << std::endl
+		<< "  --seed number         seed of the loss and reordering (1)" << std::endl;
+}
+
+/*! Parse a list of hexadecimal message types into \a types */
+static bool parseTypes(const char *list, std::vector<int> &types)
+{
+	types.clear();
+	while (*list)
+	{
+		char *end;
+		long type = strtol(list, &end, 16);
+		if (end == list || type < 0 || type > 0xFF)
+			return false;
+		types.push_back((int)type);
+		list = *end == ',' ? end + 1 : end;
+		if (*end != ',' && *end != 0)
+			return false;
+	}
+	return !types.empty();
+}
+
+static bool parseArguments(int argc, char *argv[], Settings &settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+			return false;
+
+		std::string option = argv[i];
+		const char *value = argv[++i];
+		if (option == "--host")
+			settings.host = value;
+		else if (option == "--port")
+			settings.port = atoi(value);
+		else if (option == "--avatars")
+			settings.avatars = atoi(value);
+		else if (option == "--segments")
+			settings.segments = atoi(value);
+		else if (option == "--trackers")
+			settings.trackers = atoi(value);
+		else if (option == "--rate")
+			settings.rate = atof(value);
+		else if (option == "--frames")
+			settings.frames = atol(value);
+		else if (option == "--types")
+		{
+			if (!parseTypes(value, settings.types))
+				return false;
+		}
+		else if (option == "--mtu")
+			settings.mtu = (size_t)atol(value);
+		else if (option == "--loss")
+			settings.loss = atof(value) / 100.0;
+		else if (option == "--reorder")
+			settings.reorder = atof(value) / 100.0;
+		else if (option == "--seed")
+			settings.seed = (unsigned int)atol(value);
+		else
+			return false;
+	}
+
+	// the item count of a datagram is a single byte, larger frames must be split
+	return settings.port > 0 && settings.port < 65536 && settings.avatars >= 1 && settings.avatars <= 256
+		&& settings.segments >= 1 && settings.segments <= 255 && settings.trackers >= 0 && settings.trackers <= 255
+		&& settings.rate > 0 && settings.frames >= 0;
+}
+
+int main(int argc, char *argv[])
+{
+	Settings settings;
+	if (!parseArguments(argc, argv, settings))
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	Sender sender(settings);
+	if (!sender.isOpen())
+	{
+		std::cout << "Unable to open a socket: " << strerror(errno) << std::endl;
+		return 1;
+	}
+
+	std::signal(SIGINT, handleSignal);
+	std::signal(SIGTERM, handleSignal);
+
+	Generator generator(settings, sender);
+	std::chrono::nanoseconds period((long long)(1e9 / settings.rate));
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point next = start;
+	long metaFrames = std::max(1L, (long)(METAINTERVAL * settings.rate));
+
+	std::cout << "Sending " << settings.avatars << " avatars at " << settings.rate << " Hz to "
+		<< settings.host << ":" << settings.port << std::endl;
+
+	long frame = 0;
+	for (; !g_quit && (settings.frames == 0 || frame < settings.frames); frame++)
+	{
+		// sleep until shortly before the frame is due and spin for the rest
+		std::this_thread::sleep_until(next - SPINTIME);
+		while (std::chrono::steady_clock::now() < next)
+			;
+
+		int32_t frameTime = (int32_t)std::chrono::duration_cast<std::chrono::milliseconds>(next - start).count();
+		generator.sendFrame((int32_t)frame, frameTime, frame % metaFrames == 0);
+		next += period;
+	}
+	sender.flush();
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Sent " << frame << " frames in " << elapsed << " s (" << frame / elapsed << " Hz), "
+		<< sender.sentCount() << " datagrams, " << sender.droppedCount() << " dropped, "
+		<< sender.reorderedCount() << " reordered" << std::endl;
+	return 0;
+}
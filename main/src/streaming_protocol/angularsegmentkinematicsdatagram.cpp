@@ -25,7 +25,6 @@
 */
 
 #include "angularsegmentkinematicsdatagram.h"
-#include <xsens/xsmath.h>
 
 /*! \class AngularSegmentKinematicsDatagram
 	\brief a Angular Kinematics datagram (type 0x22)
@@ -52,6 +51,7 @@
 /*! Constructor */
 AngularSegmentKinematicsDatagram::AngularSegmentKinematicsDatagram()
 	: Datagram()
+	, m_outlets("AngularKinematics", "ang")
 {
 	setType(SPAngularSegmentKinematics);
 }
@@ -64,80 +64,34 @@ AngularSegmentKinematicsDatagram::~AngularSegmentKinematicsDatagram()
 /*! Deserialize the data from \a arr
 	\sa serializeData
 */
-void AngularSegmentKinematicsDatagram::deserializeData(Streamer &inputStreamer)
+bool AngularSegmentKinematicsDatagram::deserializeData(Streamer &inputStreamer)
 {
-	Streamer* streamer = &inputStreamer;
-
-	for (int i = 0; i < dataCount(); i++)
-	{
-		Kinematics kin;
-
-		// Store the segement Id -> 4 byte 
-		streamer->read(kin.segmentId);
-
-		// Store the Segment orientation in a Vector -> 16 byte	(4 x 4 byte)
-		for (int k = 0; k < 4; k++)
-			streamer->read(kin.segmentOrien[k]);
-		// trasform in degrees
-		for (int k = 0; k < 4; k++)
-			kin.segmentOrien[k] = XsMath_rad2deg(kin.segmentOrien[k]);
-
-		// Store the Angular Velocity in a Vector -> 12 byte	(3 x 4 byte)
-		for (int k = 0; k < 3; k++)
-			streamer->read(kin.angularVeloc[k]);
-		// trasform in degrees
-		for (int k = 0; k < 3; k++)
-			kin.angularVeloc[k] = XsMath_rad2deg(kin.angularVeloc[k]);
-
-		// Store the Angular Acceleration in a Vector -> 12 byte	(3 x 4 byte)
-		for (int k = 0; k < 3; k++)
-			streamer->read(kin.angularAccel[k]);
-		// trasform in degrees
-		for (int k = 0; k < 3; k++)
-			kin.angularAccel[k] = XsMath_rad2deg(kin.angularAccel[k]);
-
-		m_data.push_back(kin);
-	}
+	static_assert(Layout::size() == 44, "Layout must match the 44 byte segment layout");
+
+	// Segment ID, orientation (4 x 4 byte), Angular Velocity and Acceleration (2 x 3 x 4 byte) are all big endian 32 bit fields
+	return decodeRecords<Layout>(inputStreamer, m_outlets);
 }
 
-// Define the stream info for LabStreamingLayer
-lsl::stream_info AngularSegmentKinematicsDatagram::info[2] = {
-	lsl::stream_info("AngularKinematics1", "MoCap", 23 * (4 + 3 + 3), lsl::IRREGULAR_RATE, lsl::cf_float32, "ang1"),
-	lsl::stream_info("AngularKinematics2", "MoCap", 23 * (4 + 3 + 3), lsl::IRREGULAR_RATE, lsl::cf_float32, "ang2")
-};
-
-// Create the streams with that stream info
-lsl::stream_outlet AngularSegmentKinematicsDatagram::outlet[2] = {
-	{AngularSegmentKinematicsDatagram::info[0]},
-	{AngularSegmentKinematicsDatagram::info[1]},
-};
-
-
-std::vector<float> AngularSegmentKinematicsDatagram::alignData() const {
-	std::vector<float> ret;
-	for (auto seg : m_data) {
-		for (auto or : seg.segmentOrien) {
-			ret.push_back(or );
-		}
-		for (auto vel : seg.angularVeloc) {
-			ret.push_back(vel);
-		}
-		for (auto acc : seg.angularAccel) {	
-			ret.push_back(acc);
-		}
-	}
-	return ret;
+/*! \returns the outlets of this datagram type */
+OutletRegistry *AngularSegmentKinematicsDatagram::outlets()
+{
+	return &m_outlets;
+}
+
+/*! \returns the decoded records */
+const float *AngularSegmentKinematicsDatagram::sample(size_t &count)
+{
+	return recordSample<Layout>(m_outlets, count);
 }
 
-void AngularSegmentKinematicsDatagram::streamData() const {
-	auto data = alignData();
-	outlet[avatarId()].push_sample(data);
+void AngularSegmentKinematicsDatagram::streamData() {
+	streamRecords<Layout>(m_outlets);
 }
 
 
 /*! Print Data datagram in a formated why
 */
-void AngularSegmentKinematicsDatagram::printData() const
+void AngularSegmentKinematicsDatagram::printData()
 {
 	streamData();
 }
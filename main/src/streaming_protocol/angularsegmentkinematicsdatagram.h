@@ -28,31 +28,34 @@
 #define ANGULARSEGMENTSKINEMATICSDATAGRAM_H
 
 #include "datagram.h"
+#include "outletregistry.h"
+#include "recordlayout.h"
 
 class AngularSegmentKinematicsDatagram : public Datagram {
 public:
 	AngularSegmentKinematicsDatagram();
 	virtual ~AngularSegmentKinematicsDatagram();
-	virtual void printData() const override;
+	virtual void printData() override;
+	virtual OutletRegistry *outlets() override;
+	virtual const float *sample(size_t &count) override;
 
 protected:
-	virtual void deserializeData(Streamer &inputStreamer) override;
+	virtual bool deserializeData(Streamer &inputStreamer) override;
 
 private:
-	struct Kinematics {
-		int segmentId;
-		float segmentOrien[4];
-		float angularVeloc[3];
-		float angularAccel[3];
-	};
+	/*! One segment on the wire, all fields are streamed in degrees */
+	typedef RecordLayout::Record<
+		RecordLayout::Skip<1>,					// segment id
+		RecordLayout::Float<4, Rad2Deg>,		// segment orientation
+		RecordLayout::Float<3, Rad2Deg>,		// angular velocity
+		RecordLayout::Float<3, Rad2Deg>			// angular acceleration
+	> Layout;
 
-	std::vector<Kinematics> m_data;
+	// the outlets per avatar, the records are decoded straight into their sample buffers
+	OutletRegistry m_outlets;
 
 public:
-	std::vector<float> alignData() const;
-	void streamData() const;
-	static lsl::stream_info info[2];
-	static lsl::stream_outlet outlet[2];
+	void streamData();
 
 };
 
@@ -0,0 +1,79 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "avatarinfo.h"
+
+/*! \class AvatarInfoTable
+  \brief The avatar descriptions received so far, indexed by avatar id
+
+  The meta datagram fills in the name of an avatar and the scale datagram its segment names. The outlets
+  use them to describe their streams and compare the revision to see whether a stream has to be
+  re-created with a new description.
+ */
+
+/*! Constructor */
+AvatarInfo::AvatarInfo()
+	: revision(0)
+{
+}
+
+/*! Constructor */
+AvatarInfoTable::AvatarInfoTable()
+{
+}
+
+/*! Destructor */
+AvatarInfoTable::~AvatarInfoTable()
+{
+}
+
+/*! Return what is known about avatar \a avatarId */
+const AvatarInfo &AvatarInfoTable::info(uint8_t avatarId) const
+{
+	return m_avatars[avatarId];
+}
+
+/*! Set the \a name of avatar \a avatarId, the revision only changes when the name does */
+void AvatarInfoTable::setName(uint8_t avatarId, const std::string &name)
+{
+	AvatarInfo &avatar = m_avatars[avatarId];
+	if (avatar.name == name)
+		return;
+
+	avatar.name = name;
+	avatar.revision++;
+}
+
+/*! Set the \a segmentNames of avatar \a avatarId, the revision only changes when the names do */
+void AvatarInfoTable::setSegmentNames(uint8_t avatarId, const std::vector<std::string> &segmentNames)
+{
+	AvatarInfo &avatar = m_avatars[avatarId];
+	if (avatar.segmentNames == segmentNames)
+		return;
+
+	avatar.segmentNames = segmentNames;
+	avatar.revision++;
+}
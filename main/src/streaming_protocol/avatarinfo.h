@@ -0,0 +1,61 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef AVATARINFO_H
+#define AVATARINFO_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*! What the meta and scale datagrams tell about one avatar */
+struct AvatarInfo
+{
+	AvatarInfo();
+
+	std::string name;
+	std::vector<std::string> segmentNames;
+
+	// increases whenever the name or the segment names change
+	unsigned int revision;
+};
+
+class AvatarInfoTable
+{
+public:
+	AvatarInfoTable();
+	~AvatarInfoTable();
+
+	const AvatarInfo &info(uint8_t avatarId) const;
+	void setName(uint8_t avatarId, const std::string &name);
+	void setSegmentNames(uint8_t avatarId, const std::vector<std::string> &segmentNames);
+
+private:
+	std::array<AvatarInfo, 256> m_avatars;
+};
+
+#endif
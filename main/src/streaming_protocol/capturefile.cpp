@@ -0,0 +1,569 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "capturefile.h"
+#include "datagramheader.h"
+#include "lsl_cpp.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+const char CaptureFormat::MAGIC[8] = { 'M', 'X', 'T', 'P', 'C', 'A', 'P', 'T' };
+const char CaptureFormat::INDEXMAGIC[8] = { 'M', 'X', 'T', 'P', 'I', 'N', 'D', 'X' };
+
+// segments are a multiple of the Windows allocation granularity, which is a multiple of any page size
+static const uint64_t SEGMENTGRANULARITY = 64 * 1024;
+
+// a segment always has room for the file header and the largest UDP datagram
+static const uint64_t MINIMUMSEGMENTSIZE = 1024 * 1024;
+
+// the receive time between index entries, a seek reads at most this much of the capture
+static const double INDEXINTERVAL = 0.1;
+
+// room for an hour of index entries before the index grows
+static const size_t INDEXRESERVE = 36000;
+
+// the background thread also checks for a new segment this often, in case it missed a wake up
+static const std::chrono::milliseconds PREPAREINTERVAL(100);
+
+// the fields of a capture file are little endian
+static void store32(uint8_t *destination, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		destination[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void store64(uint8_t *destination, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+		destination[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void storeDouble(uint8_t *destination, double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	store64(destination, bits);
+}
+
+static uint32_t load32(const uint8_t *source)
+{
+	uint32_t value = 0;
+	for (int i = 3; i >= 0; i--)
+		value = value << 8 | source[i];
+	return value;
+}
+
+static uint64_t load64(const uint8_t *source)
+{
+	uint64_t value = 0;
+	for (int i = 7; i >= 0; i--)
+		value = value << 8 | source[i];
+	return value;
+}
+
+static double loadDouble(const uint8_t *source)
+{
+	uint64_t bits = load64(source);
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/*! \class CaptureWriter
+	\brief A record of what the suit sent, written without blocking the receive thread on the disk
+
+	The file consists of segments of equal size. A datagram is appended by copying it into the mapped segment,
+	which never waits for the disk: the background thread extends the file and maps the next segment while the
+	current one fills up, and unmaps full segments, leaving the write-back to the kernel. When the next segment
+	is not mapped in time the datagram is not captured and counted as dropped, the receive thread does not wait.
+
+	The file starts with a header: the magic "MXTPCAPT", the format version, the header size, the segment size,
+	and the local clock and the UTC time the capture started at, to relate the receive times to the wall clock.
+	Every record is the datagram size, its receive time in seconds of the local clock and the datagram itself.
+	A record does not cross a segment boundary, a record size of 0xFFFFFFFF continues at the next segment.
+	All fields are little endian.
+
+	Closing the capture truncates the file after the last record and appends the index: an entry for the first
+	datagram in every 100 ms of receive time with its sample counter and file offset, followed by a trailer
+	with the offset and entry count of the index and the magic "MXTPINDX". A capture that was not closed still
+	reads up to its first record size of 0, as the preallocated part of the file is zero.
+*/
+
+/*! Create the capture file \a path, with segments of at least \a segmentSize bytes
+
+	The first two segments are mapped before this returns, isOpen() tells whether that worked.
+*/
+CaptureWriter::CaptureWriter(const std::string &path, size_t segmentSize)
+	: m_path(path)
+	, m_fileSize(0)
+	, m_segment(nullptr)
+	, m_position(0)
+	, m_lastIndexTime(-std::numeric_limits<double>::infinity())
+	, m_current(0)
+	, m_ready(0)
+	, m_stopping(false)
+	, m_recordCount(0)
+	, m_droppedCount(0)
+{
+	m_segmentSize = std::max((uint64_t)segmentSize, MINIMUMSEGMENTSIZE);
+	m_segmentSize = (m_segmentSize + SEGMENTGRANULARITY - 1) / SEGMENTGRANULARITY * SEGMENTGRANULARITY;
+	std::fill(m_views, m_views + VIEWCOUNT, nullptr);
+
+	if (!openFile())
+	{
+		std::cout << "Unable to create capture file " << m_path << std::endl;
+		return;
+	}
+
+	if (extendFile(2 * m_segmentSize))
+	{
+		m_views[0] = mapSegment(0);
+		m_views[1] = mapSegment(1);
+	}
+	if (!m_views[0] || !m_views[1])
+	{
+		std::cout << "Unable to map capture file " << m_path << std::endl;
+		for (uint8_t *&view : m_views)
+		{
+			if (view)
+				unmapSegment(view);
+			view = nullptr;
+		}
+		finishFile(0, std::vector<uint8_t>());
+		return;
+	}
+
+	m_segment = m_views[0];
+	m_ready.store(1, std::memory_order_relaxed);
+
+	memcpy(m_segment, CaptureFormat::MAGIC, sizeof(CaptureFormat::MAGIC));
+	store32(m_segment + 8, CaptureFormat::VERSION);
+	store32(m_segment + 12, (uint32_t)CaptureFormat::HEADERSIZE);
+	store64(m_segment + 16, m_segmentSize);
+	storeDouble(m_segment + 24, lsl::local_clock());
+	storeDouble(m_segment + 32, std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count());
+	m_position = CaptureFormat::HEADERSIZE;
+
+	m_index.reserve(INDEXRESERVE);
+	m_thread = std::thread(&CaptureWriter::prepareSegments, this);
+}
+
+/*! Destructor, closes the capture */
+CaptureWriter::~CaptureWriter()
+{
+	close();
+}
+
+/*! Append the datagram of \a size bytes at \a data, received at \a timestamp
+
+	Only one thread may append. Empty datagrams are not captured.
+*/
+void CaptureWriter::append(const uint8_t *data, size_t size, double timestamp)
+{
+	if (!m_segment || size == 0)
+		return;
+
+	size_t recordSize = CaptureFormat::RECORDHEADERSIZE + size;
+	uint64_t current = m_current.load(std::memory_order_relaxed);
+	if (m_position + recordSize > m_segmentSize)
+	{
+		// move on to the next segment if the background thread mapped it, rather than wait for it
+		if (m_ready.load(std::memory_order_acquire) <= current)
+		{
+			drop();
+			return;
+		}
+
+		if (m_position + sizeof(uint32_t) <= m_segmentSize)
+			store32(m_segment + m_position, CaptureFormat::PADDING);
+
+		current++;
+		m_segment = m_views[current % VIEWCOUNT];
+		m_position = 0;
+		m_current.store(current, std::memory_order_release);
+		m_wake.notify_one();
+	}
+
+	uint64_t offset = current * m_segmentSize + m_position;
+	if (timestamp - m_lastIndexTime >= INDEXINTERVAL)
+	{
+		DatagramHeader header(data, size);
+		if (header.isValid())
+		{
+			CaptureFormat::IndexEntry entry = { timestamp, header.sampleCounter(), offset };
+			m_index.push_back(entry);
+			m_lastIndexTime = timestamp;
+		}
+	}
+
+	uint8_t *record = m_segment + m_position;
+	store32(record, (uint32_t)size);
+	storeDouble(record + 4, timestamp);
+	memcpy(record + CaptureFormat::RECORDHEADERSIZE, data, size);
+	m_position += recordSize;
+
+	m_recordCount.store(m_recordCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/*! Count a datagram that was received but cannot be captured, such as one that was larger than the receive buffer
+
+	Only the appending thread may call this.
+*/
+void CaptureWriter::drop()
+{
+	m_droppedCount.store(m_droppedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/*! Stop the background thread, then truncate the file after the last record and append the index
+
+	The appending thread must have stopped appending.
+*/
+void CaptureWriter::close()
+{
+	if (!m_segment)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_one();
+	m_thread.join();
+
+	for (uint8_t *&view : m_views)
+	{
+		if (view)
+			unmapSegment(view);
+		view = nullptr;
+	}
+
+	uint64_t size = m_current.load(std::memory_order_relaxed) * m_segmentSize + m_position;
+
+	std::vector<uint8_t> footer(m_index.size() * CaptureFormat::INDEXENTRYSIZE + CaptureFormat::TRAILERSIZE, 0);
+	uint8_t *field = footer.data();
+	for (const CaptureFormat::IndexEntry &entry : m_index)
+	{
+		storeDouble(field, entry.time);
+		store32(field + 8, (uint32_t)entry.sampleCounter);
+		store64(field + 16, entry.offset);
+		field += CaptureFormat::INDEXENTRYSIZE;
+	}
+	store64(field, size);
+	store64(field + 8, m_index.size());
+	memcpy(field + 16, CaptureFormat::INDEXMAGIC, sizeof(CaptureFormat::INDEXMAGIC));
+
+	finishFile(size, footer);
+	m_segment = nullptr;
+}
+
+/*! Keep the segment after the current one mapped, and unmap the one before it */
+void CaptureWriter::prepareSegments()
+{
+	bool failed = false;
+	while (!m_stopping)
+	{
+		uint64_t current = m_current.load(std::memory_order_acquire);
+
+		// the appending thread is done with the previous segment, the kernel writes it back after the unmap
+		if (current > 0 && m_views[(current - 1) % VIEWCOUNT])
+		{
+			unmapSegment(m_views[(current - 1) % VIEWCOUNT]);
+			m_views[(current - 1) % VIEWCOUNT] = nullptr;
+		}
+
+		uint64_t next = current + 1;
+		if (m_ready.load(std::memory_order_relaxed) < next)
+		{
+			uint8_t *view = extendFile((next + 1) * m_segmentSize) ? mapSegment(next) : nullptr;
+			if (view)
+			{
+				m_views[next % VIEWCOUNT] = view;
+				m_ready.store(next, std::memory_order_release);
+				failed = false;
+			}
+			else if (!failed)
+			{
+				std::cout << "Unable to extend capture file " << m_path << ", datagrams are dropped" << std::endl;
+				failed = true;
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_wake.wait_for(lock, PREPAREINTERVAL, [&]() {
+			return m_stopping || m_current.load(std::memory_order_relaxed) != current;
+		});
+	}
+}
+
+#ifdef _WIN32
+
+bool CaptureWriter::openFile()
+{
+	m_file = CreateFileA(m_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+	return m_file != INVALID_HANDLE_VALUE;
+}
+
+bool CaptureWriter::extendFile(uint64_t size)
+{
+	if (size <= m_fileSize)
+		return true;
+
+	LARGE_INTEGER end;
+	end.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+		return false;
+	m_fileSize = size;
+	return true;
+}
+
+uint8_t *CaptureWriter::mapSegment(uint64_t segment)
+{
+	// a mapping cannot grow, every segment gets one that reaches its end
+	uint64_t end = (segment + 1) * m_segmentSize;
+	HANDLE mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, (DWORD)(end >> 32), (DWORD)end, nullptr);
+	if (!mapping)
+		return nullptr;
+
+	uint64_t offset = segment * m_segmentSize;
+	void *view = MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)offset, (SIZE_T)m_segmentSize);
+	CloseHandle(mapping);
+	return (uint8_t*)view;
+}
+
+void CaptureWriter::unmapSegment(uint8_t *view)
+{
+	UnmapViewOfFile(view);
+}
+
+void CaptureWriter::finishFile(uint64_t size, const std::vector<uint8_t> &footer)
+{
+	LARGE_INTEGER end;
+	end.QuadPart = (LONGLONG)size;
+	SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN);
+	SetEndOfFile(m_file);
+
+	DWORD written = 0;
+	if (!footer.empty() && !WriteFile(m_file, footer.data(), (DWORD)footer.size(), &written, nullptr))
+		std::cout << "Unable to write the index of capture file " << m_path << std::endl;
+	CloseHandle(m_file);
+	m_file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool CaptureWriter::openFile()
+{
+	m_file = open(m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	return m_file >= 0;
+}
+
+bool CaptureWriter::extendFile(uint64_t size)
+{
+	if (size <= m_fileSize)
+		return true;
+
+	// allocating the blocks up front keeps the page faults of the appending thread away from the file system
+#if defined(__linux__)
+	if (posix_fallocate(m_file, (off_t)m_fileSize, (off_t)(size - m_fileSize)) != 0)
+#else
+	if (ftruncate(m_file, (off_t)size) != 0)
+#endif
+		return false;
+	m_fileSize = size;
+	return true;
+}
+
+uint8_t *CaptureWriter::mapSegment(uint64_t segment)
+{
+	int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+	flags |= MAP_POPULATE;
+#endif
+	void *view = mmap(nullptr, (size_t)m_segmentSize, PROT_READ | PROT_WRITE, flags, m_file,
+		(off_t)(segment * m_segmentSize));
+	return view == MAP_FAILED ? nullptr : (uint8_t*)view;
+}
+
+void CaptureWriter::unmapSegment(uint8_t *view)
+{
+	munmap(view, (size_t)m_segmentSize);
+}
+
+void CaptureWriter::finishFile(uint64_t size, const std::vector<uint8_t> &footer)
+{
+	if (ftruncate(m_file, (off_t)size) != 0 ||
+			(!footer.empty() && pwrite(m_file, footer.data(), footer.size(), (off_t)size) != (ssize_t)footer.size()))
+		std::cout << "Unable to write the index of capture file " << m_path << std::endl;
+	::close(m_file);
+	m_file = -1;
+}
+
+#endif
+
+/*! \class CaptureReader
+	\brief Reads a capture file of a CaptureWriter
+
+	The records are read one by one from a file offset. findTime() and findSampleCounter() look up the index
+	entry before the wanted datagram and read on from there. A capture without an index, because it was not
+	closed, is read from its first record.
+*/
+
+/*! Open the capture file \a path, isOpen() tells whether it is one */
+CaptureReader::CaptureReader(const std::string &path)
+	: m_file(path, std::ios::binary)
+	, m_segmentSize(0)
+	, m_dataSize(0)
+{
+	uint8_t header[CaptureFormat::HEADERSIZE];
+	if (!m_file.read((char*)header, sizeof(header)) ||
+			memcmp(header, CaptureFormat::MAGIC, sizeof(CaptureFormat::MAGIC)) != 0 ||
+			load32(header + 8) != CaptureFormat::VERSION)
+		return;
+
+	m_file.seekg(0, std::ios::end);
+	uint64_t fileSize = (uint64_t)m_file.tellg();
+	m_dataSize = fileSize;
+
+	uint8_t trailer[CaptureFormat::TRAILERSIZE];
+	if (fileSize >= CaptureFormat::HEADERSIZE + CaptureFormat::TRAILERSIZE)
+	{
+		m_file.seekg((std::streamoff)(fileSize - CaptureFormat::TRAILERSIZE));
+		if (m_file.read((char*)trailer, sizeof(trailer)) &&
+				memcmp(trailer + 16, CaptureFormat::INDEXMAGIC, sizeof(CaptureFormat::INDEXMAGIC)) == 0)
+		{
+			uint64_t indexOffset = load64(trailer);
+			uint64_t count = load64(trailer + 8);
+			if (indexOffset + count * CaptureFormat::INDEXENTRYSIZE + CaptureFormat::TRAILERSIZE == fileSize)
+			{
+				std::vector<uint8_t> entries((size_t)(count * CaptureFormat::INDEXENTRYSIZE));
+				m_file.seekg((std::streamoff)indexOffset);
+				if (entries.empty() || m_file.read((char*)entries.data(), entries.size()))
+				{
+					for (size_t i = 0; i < count; i++)
+					{
+						const uint8_t *field = entries.data() + i * CaptureFormat::INDEXENTRYSIZE;
+						CaptureFormat::IndexEntry entry = { loadDouble(field), (int32_t)load32(field + 8), load64(field + 16) };
+						m_index.push_back(entry);
+					}
+					m_dataSize = indexOffset;
+				}
+			}
+		}
+	}
+
+	m_file.clear();
+	m_segmentSize = load64(header + 16);
+}
+
+/*! \returns the offset of the first record received at or after \a time, or past the last record if there is none */
+uint64_t CaptureReader::findTime(double time)
+{
+	auto after = std::lower_bound(m_index.begin(), m_index.end(), time,
+		[](const CaptureFormat::IndexEntry &entry, double value) { return entry.time < value; });
+	uint64_t offset = after == m_index.begin() ? firstRecord() : (after - 1)->offset;
+
+	Record record;
+	for (uint64_t start = offset; read(offset, record); start = offset)
+		if (record.time >= time)
+			return start;
+	return m_dataSize;
+}
+
+/*! \returns the offset of the first datagram with a sample counter of at least \a sampleCounter, or past the last
+	record if there is none
+
+	The sample counters are assumed to increase through the capture, as they do while MVN keeps streaming.
+*/
+uint64_t CaptureReader::findSampleCounter(int32_t sampleCounter)
+{
+	auto after = std::lower_bound(m_index.begin(), m_index.end(), sampleCounter,
+		[](const CaptureFormat::IndexEntry &entry, int32_t value) { return entry.sampleCounter < value; });
+	uint64_t offset = after == m_index.begin() ? firstRecord() : (after - 1)->offset;
+
+	Record record;
+	for (uint64_t start = offset; read(offset, record); start = offset)
+	{
+		DatagramHeader header(record.data.data(), record.data.size());
+		if (header.isValid() && header.sampleCounter() >= sampleCounter)
+			return start;
+	}
+	return m_dataSize;
+}
+
+/*! Read the record at \a offset into \a record and advance \a offset to the next one
+
+	\returns false at the end of the records
+*/
+bool CaptureReader::read(uint64_t &offset, Record &record)
+{
+	while (isOpen() && offset < m_dataSize)
+	{
+		uint64_t remaining = m_segmentSize - offset % m_segmentSize;
+		if (remaining < CaptureFormat::RECORDHEADERSIZE)
+		{
+			offset += remaining;
+			continue;
+		}
+
+		uint8_t header[CaptureFormat::RECORDHEADERSIZE];
+		m_file.clear();
+		m_file.seekg((std::streamoff)offset);
+		if (!m_file.read((char*)header, sizeof(header)))
+			return false;
+
+		uint32_t size = load32(header);
+		if (size == CaptureFormat::PADDING)
+		{
+			offset += remaining;
+			continue;
+		}
+		if (size == 0 || size > remaining - CaptureFormat::RECORDHEADERSIZE)
+			return false;
+
+		record.time = loadDouble(header + 4);
+		record.data.resize(size);
+		if (!m_file.read((char*)record.data.data(), size))
+			return false;
+		offset += CaptureFormat::RECORDHEADERSIZE + size;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,155 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef CAPTUREFILE_H
+#define CAPTUREFILE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*! The layout of a capture file, shared by its writer and reader */
+struct CaptureFormat
+{
+	static const char MAGIC[8];
+	static const char INDEXMAGIC[8];
+	static const uint32_t VERSION = 1;
+
+	static const size_t HEADERSIZE = 40;		// magic, version, header size, segment size, start times
+	static const size_t RECORDHEADERSIZE = 12;	// datagram size and receive time
+	static const size_t INDEXENTRYSIZE = 24;	// receive time, sample counter and file offset of a record
+	static const size_t TRAILERSIZE = 24;		// index offset, index entry count and index magic
+
+	// a record size that sends the reader to the next segment, a size of 0 ends the records
+	static const uint32_t PADDING = 0xFFFFFFFF;
+
+	/*! An index entry, every INDEXINTERVAL seconds of received datagrams point to a record */
+	struct IndexEntry
+	{
+		double time;
+		int32_t sampleCounter;
+		uint64_t offset;
+	};
+};
+
+/*! Appends raw datagrams to a capture file through memory mapped segments
+
+	The datagrams are appended by one thread, which only copies them into a mapped segment. A background
+	thread extends the file and maps the next segment ahead of time, and unmaps the ones that are full.
+*/
+class CaptureWriter
+{
+public:
+	CaptureWriter(const std::string &path, size_t segmentSize = 64 * 1024 * 1024);
+	~CaptureWriter();
+
+	bool isOpen() const { return m_segment != nullptr; }
+	const std::string &path() const { return m_path; }
+
+	void append(const uint8_t *data, size_t size, double timestamp);
+	void drop();
+	void close();
+
+	// statistics, safe to read from any thread
+	size_t recordCount() const { return m_recordCount.load(std::memory_order_relaxed); }
+	size_t droppedCount() const { return m_droppedCount.load(std::memory_order_relaxed); }
+
+private:
+	// the current segment, the one mapped ahead of it and the one being unmapped
+	static const size_t VIEWCOUNT = 3;
+
+	bool openFile();
+	bool extendFile(uint64_t size);
+	uint8_t *mapSegment(uint64_t segment);
+	void unmapSegment(uint8_t *view);
+	void finishFile(uint64_t size, const std::vector<uint8_t> &footer);
+	void prepareSegments();
+
+	std::string m_path;
+	uint64_t m_segmentSize;
+	uint64_t m_fileSize;
+
+#ifdef _WIN32
+	void *m_file;		// a HANDLE, windows.h is left out of the header
+#else
+	int m_file;
+#endif
+	uint8_t *m_views[VIEWCOUNT];
+
+	// owned by the appending thread
+	uint8_t *m_segment;
+	size_t m_position;
+	std::vector<CaptureFormat::IndexEntry> m_index;
+	double m_lastIndexTime;
+
+	// the segment the appending thread writes to, and the last one the background thread mapped
+	std::atomic<uint64_t> m_current;
+	std::atomic<uint64_t> m_ready;
+
+	std::atomic<bool> m_stopping;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::thread m_thread;
+
+	std::atomic<size_t> m_recordCount;
+	std::atomic<size_t> m_droppedCount;
+};
+
+/*! Reads the datagrams of a capture file, and finds them by receive time or sample counter */
+class CaptureReader
+{
+public:
+	/*! A captured datagram */
+	struct Record
+	{
+		double time;
+		std::vector<uint8_t> data;
+	};
+
+	explicit CaptureReader(const std::string &path);
+
+	bool isOpen() const { return m_segmentSize != 0; }
+	const std::vector<CaptureFormat::IndexEntry> &index() const { return m_index; }
+
+	uint64_t firstRecord() const { return CaptureFormat::HEADERSIZE; }
+	uint64_t findTime(double time);
+	uint64_t findSampleCounter(int32_t sampleCounter);
+	bool read(uint64_t &offset, Record &record);
+
+private:
+	std::ifstream m_file;
+	uint64_t m_segmentSize;
+	uint64_t m_dataSize;
+	std::vector<CaptureFormat::IndexEntry> m_index;
+};
+
+#endif
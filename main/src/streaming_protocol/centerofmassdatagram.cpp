@@ -43,6 +43,7 @@
 /*! Constructor */
 CenterOfMassDatagram::CenterOfMassDatagram()
 	: Datagram()
+	, m_outlets("CenterOfMass", "com")
 {
 	setType(SPCenterOfMass);
 }
@@ -55,34 +56,39 @@ CenterOfMassDatagram::~CenterOfMassDatagram()
 /*! Deserialize the data from \a arr
 	\sa serializeData
 */
-void CenterOfMassDatagram::deserializeData(Streamer &inputStreamer)
+bool CenterOfMassDatagram::deserializeData(Streamer &inputStreamer)
 {
 	Streamer* streamer = &inputStreamer;
 
+	if (!streamer->canRead(sizeof(m_pos)))
+		return false;
+
 	// extract the coordinates of the position
-	for (int k = 0; k < 3; k++)
-		streamer->read(m_pos[k]);
+	streamer->read(m_pos, 3);
+
+	return true;
 }
 
-// Define the stream info for LabStreamingLayer
-lsl::stream_info CenterOfMassDatagram::info[2]{
-	lsl::stream_info("CenterOfMass1", "MoCap", 3, lsl::IRREGULAR_RATE, lsl::cf_float32, "com1"),
-	lsl::stream_info("CenterOfMass2", "MoCap", 3, lsl::IRREGULAR_RATE, lsl::cf_float32, "com2")
-};
+/*! \returns the outlets of this datagram type */
+OutletRegistry *CenterOfMassDatagram::outlets()
+{
+	return &m_outlets;
+}
 
-// Create the streams with that stream info
-lsl::stream_outlet CenterOfMassDatagram::outlet[2]{
-	{CenterOfMassDatagram::info[0]},
-	{CenterOfMassDatagram::info[1]}
-};
+/*! \returns the decoded position */
+const float *CenterOfMassDatagram::sample(size_t &count)
+{
+	count = 3;
+	return m_pos;
+}
 
-void CenterOfMassDatagram::streamData() const {
-	outlet[avatarId()].push_sample(m_pos);
+void CenterOfMassDatagram::streamData() {
+	m_outlets.outlet(avatarId(), 1, 3, avatarInfo()).push(m_pos, timestamp());
 }
 
 /*! Print Data datagram in a formated why
 */
-void CenterOfMassDatagram::printData() const
+void CenterOfMassDatagram::printData()
 {
 	streamData();
 }
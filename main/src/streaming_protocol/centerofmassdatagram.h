@@ -28,24 +28,26 @@
 #define CENTEROFMASSDATAGRAM_H
 
 #include "datagram.h"
+#include "outletregistry.h"
 
 class CenterOfMassDatagram : public Datagram {
 
 public:
 	CenterOfMassDatagram();
 	virtual ~CenterOfMassDatagram();
-	virtual void printData() const override;
+	virtual void printData() override;
+	virtual OutletRegistry *outlets() override;
+	virtual const float *sample(size_t &count) override;
 
 protected:
-	virtual void deserializeData(Streamer &inputStreamer) override;
+	virtual bool deserializeData(Streamer &inputStreamer) override;
 
 private:
 	float m_pos[3];
+	OutletRegistry m_outlets;
 
 public:
-	void streamData() const;
-	static lsl::stream_info info[2];
-	static lsl::stream_outlet outlet[2];
+	void streamData();
 };
 
 #endif
@@ -0,0 +1,112 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "chunkpolicy.h"
+#include <cstdio>
+#include <cstring>
+
+/*! \class ChunkPolicies
+  \brief The latency/throughput setting of each stream
+
+  By default every sample is pushed to LSL as soon as it is parsed, which costs one network transfer per
+  sample per stream. A policy with more than one frame collects samples and pushes them as one chunk, with
+  the timestamp of every sample, once the frame count is reached or the oldest pending sample is older than
+  the time limit. Larger chunks mean fewer transfers at the cost of up to that much extra latency.
+
+  Pushed samples are normally sent at once. Without pushthrough liblsl keeps them in its send buffer until
+  a transfer chunk of the policy's frame count is complete, which trades more latency for fewer transfers
+  when several chunks are pushed faster than the network round trip.
+ */
+
+/*! Constructor, the default pushes every sample immediately */
+ChunkPolicy::ChunkPolicy(int frames, int milliseconds, bool pushthrough)
+	: frames(frames < 1 ? 1 : frames)
+	, milliseconds(milliseconds < 0 ? 0 : milliseconds)
+	, pushthrough(pushthrough)
+{
+}
+
+/*! \returns true if every sample is pushed on its own */
+bool ChunkPolicy::isImmediate() const
+{
+	return frames <= 1;
+}
+
+/*! Constructor */
+ChunkPolicies::ChunkPolicies()
+{
+}
+
+/*! Return the policy for messages of \a messageType */
+const ChunkPolicy &ChunkPolicies::policy(int messageType) const
+{
+	std::map<int, ChunkPolicy>::const_iterator it = m_policies.find(messageType);
+	return it != m_policies.end() ? it->second : m_default;
+}
+
+/*! Set the \a policy for all message types without a policy of their own */
+void ChunkPolicies::setPolicy(const ChunkPolicy &policy)
+{
+	m_default = policy;
+}
+
+/*! Set the \a policy for messages of \a messageType */
+void ChunkPolicies::setPolicy(int messageType, const ChunkPolicy &policy)
+{
+	m_policies[messageType] = policy;
+}
+
+/*! Parse a command line \a setting of the form [type=]frames[:milliseconds[:pushthrough]]
+
+	The type is the hexadecimal message type, as in the MXTP header (e.g. 02 for quaternions).
+	Without a type the setting becomes the default. The pushthrough flag is 1 (the default) or 0.
+	\returns false if the setting could not be parsed
+*/
+bool ChunkPolicies::parse(const std::string &setting)
+{
+	unsigned int type = 0;
+	int frames = 1, milliseconds = 0, pushthrough = 1;
+	const char* str = setting.c_str();
+	bool hasType = setting.find('=') != std::string::npos;
+
+	if (hasType)
+	{
+		if (sscanf(str, "%x=", &type) != 1 || type > 0xFF)
+			return false;
+		str = strchr(str, '=') + 1;
+	}
+
+	int fields = sscanf(str, "%d:%d:%d", &frames, &milliseconds, &pushthrough);
+	if (fields < 1 || frames < 1 || milliseconds < 0 || (pushthrough != 0 && pushthrough != 1))
+		return false;
+
+	if (hasType)
+		setPolicy(static_cast<int>(type), ChunkPolicy(frames, milliseconds, pushthrough != 0));
+	else
+		setPolicy(ChunkPolicy(frames, milliseconds, pushthrough != 0));
+
+	return true;
+}
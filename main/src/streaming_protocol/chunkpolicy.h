@@ -0,0 +1,65 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef CHUNKPOLICY_H
+#define CHUNKPOLICY_H
+
+#include <map>
+#include <string>
+
+/*! When the samples of an outlet are handed to liblsl */
+struct ChunkPolicy
+{
+	ChunkPolicy(int frames = 1, int milliseconds = 0, bool pushthrough = true);
+
+	bool isImmediate() const;
+
+	// push once this many samples are pending, 1 pushes every sample on its own
+	int frames;
+	// push once the oldest pending sample is this old, 0 waits for the frame count only
+	int milliseconds;
+	// send the pushed samples right away, false lets liblsl hold them until its transfer chunk is full
+	bool pushthrough;
+};
+
+/*! The chunk policy of every message type, with one default for the types that are not listed */
+class ChunkPolicies
+{
+public:
+	ChunkPolicies();
+
+	const ChunkPolicy &policy(int messageType) const;
+	void setPolicy(const ChunkPolicy &policy);
+	void setPolicy(int messageType, const ChunkPolicy &policy);
+
+	bool parse(const std::string &setting);
+
+private:
+	ChunkPolicy m_default;
+	std::map<int, ChunkPolicy> m_policies;
+};
+
+#endif
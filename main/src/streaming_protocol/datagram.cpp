@@ -25,6 +25,7 @@
 */
 
 #include "datagram.h"
+#include "datagramheader.h"
 
 /*! \class Datagram
 
@@ -39,15 +40,16 @@
 const float Datagram::EULERPOSITIONSCALE = 100.0;
 
 Datagram::Datagram() :
-		m_header("MXTP00"),
+		m_type(0),
 		m_avatarId(0),
 		m_dgramCounter(0x80),
 		m_dataCount(0),
 		m_frameTime(0),
 		m_sampleCounter(0),
-		m_dataSize(0)
+		m_dataSize(0),
+		m_avatars(nullptr),
+		m_timestamp(0)
 {
-	initMap(m_packetsName);
 }
 
 /*! Destructor */
@@ -61,60 +63,44 @@ int Datagram::getDataSize() const
 	return m_dataSize;
 }
 
-/*! The datagrams message type */
-int Datagram::messageType(const XsByteArray &array)
+/*! The message type of the \a size bytes at \a data
+	\returns -1 if the data does not start with a valid header
+*/
+int Datagram::messageType(const uint8_t* data, size_t size)
 {
-	std::stringstream tp;
-	// extract the 5th and 6th digits that represent the code of the packet
-	tp << array[4] << array[5];
-	std::string type;
-	tp >> type;
-	// convert to hex
-	int sp = std::stoi(type,nullptr,16);
-	
-	return sp;
+	return DatagramHeader(data, size).messageType();
 }
 
 /*! The datagrams message type */
 int Datagram::messageType() const
 {
-	std::string header = m_header;
-	std::string type = header.substr(4, header.size()-4);
-	int sp = std::stoi (type,nullptr,16);
-
-	return sp;
+	return m_type;
 }
 
 /*! Set the type of the message */
 void Datagram::setType(StreamingProtocol proto)
 {
-	std::stringstream hexSS;
-	hexSS.width(2);
-	hexSS.fill('0');
-	hexSS << std::hex << proto;
-	m_header = "MXTP" +  hexSS.str();
+	m_type = proto;
 }
 
-/*! Deserializes the datagram from given byte array \a arr.
+/*! Deserializes the datagram from the \a size bytes at \a data.
+	\returns false if the data does not start with a valid header or its payload is truncated
 */
-bool Datagram::deserialize(const XsByteArray& arr)
+bool Datagram::deserialize(const uint8_t* data, size_t size)
 {
-	Streamer streamer(arr);
-	std::string messageType;
+	DatagramHeader header(data, size);
+	if (!header.isValid())
+		return false;
 
-	// extract only the byte for the header (24 bytes)
-	streamer.read(messageType,6);		// 6 bytes
-	streamer.read(m_sampleCounter);		// 4 bytes
-	streamer.read(m_dgramCounter);		// 1 bytes
-	streamer.read(m_dataCount);			// 1 bytes
-	streamer.read(m_frameTime);			// 4 bytes
-	streamer.read(m_avatarId);			// 1 bytes
-	streamer.read(std::string(),7);		// remove other 7 bytes 
+	m_sampleCounter = header.sampleCounter();
+	m_dgramCounter = header.datagramCounter();
+	m_dataCount = header.dataCount();
+	m_frameTime = header.frameTime();
+	m_avatarId = header.avatarId();
 
 	// deserialize the data part of the Packet
-	deserializeData(streamer);
-
-	return true;
+	Streamer streamer(header.payload(), header.payloadSize());
+	return deserializeData(streamer);
 }
 
 
@@ -150,6 +136,55 @@ void Datagram::setDataCount(uint8_t c)
 	m_dataCount = c;
 }
 
+/*! Set the local clock time at which the frame of this datagram was captured */
+void Datagram::setTimestamp(double timestamp)
+{
+	m_timestamp = timestamp;
+}
+
+/*! \returns the local clock time at which the frame of this datagram was captured
+	\sa SenderClock
+*/
+double Datagram::timestamp() const
+{
+	return m_timestamp;
+}
+
+/*! \returns the LSL outlets of this datagram type, or nullptr if it is not streamed */
+OutletRegistry *Datagram::outlets()
+{
+	return nullptr;
+}
+
+/*! The decoded values of the current datagram as they are streamed
+
+	\param count Receives the number of values
+	\returns nullptr if this datagram type does not stream its values as one flat sample
+*/
+const float *Datagram::sample(size_t &count)
+{
+	count = 0;
+	return nullptr;
+}
+
+/*! Share the descriptions of the avatars in \a avatars between all datagram types */
+void Datagram::setAvatarInfo(AvatarInfoTable *avatars)
+{
+	m_avatars = avatars;
+}
+
+/*! \returns what is known about the avatar of the current datagram, or nullptr if no table was set */
+const AvatarInfo *Datagram::avatarInfo() const
+{
+	return m_avatars ? &m_avatars->info(m_avatarId) : nullptr;
+}
+
+/*! \returns the table of avatar descriptions, or nullptr if none was set */
+AvatarInfoTable *Datagram::avatarInfoTable() const
+{
+	return m_avatars;
+}
+
 /*! The sample counter is a 32-bit unsigned integer value which is incremented by one each time a new set of motion sensor data is sampled and sent away. Note that the sample counter is not to be interpreted as a time code, since the sender may skip frames. */
 int32_t Datagram::sampleCounter() const
 {
@@ -188,47 +223,49 @@ int32_t Datagram::frameTime() const
 	return m_frameTime;
 }
 
-/*! Map the StreamingProtocol names to a user friendly version
-*/
-void Datagram::initMap(std::map<int, std::string> &map)
+namespace {
+
+/*! A user friendly name of a StreamingProtocol */
+struct ProtocolName {
+	int proto;
+	const char* name;
+};
+
+/*! The StreamingProtocol names, shared by all datagrams */
+constexpr ProtocolName PROTOCOLNAMES[] = {
+	{ SPPoseEuler, "Position + Orientation (Euler)" },
+	{ SPPoseQuaternion, "Position + Orientation (Quaternion)" },
+	{ SPPosePositions, "Virtual Optical Marker Set" },
+	{ SPJackProcessSimulate, "Siemens Tecnomatix" },
+	{ SPPoseUnity3D, "Unity 3D" },
+
+	{ SPMetaMoreMeta, "Character Meta Data" },
+	{ SPMetaScaling, "Scaling Data" },
+
+	{ SPJointAngles, "Joint Angles" },
+	{ SPLinearSegmentKinematics, "Linear Segment Kinematics" },
+	{ SPAngularSegmentKinematics, "Angular Segment Kinematics" },
+	{ SPTrackerKinematics, "Tracker Kinematics" },
+	{ SPCenterOfMass, "Center of Mass" },
+	{ SPTimeCode, "Time Code" },
+};
+
+constexpr size_t PROTOCOLNAMECOUNT = sizeof(PROTOCOLNAMES) / sizeof(PROTOCOLNAMES[0]);
+
+/*! Look up the name of \a proto in the table, starting at \a index */
+constexpr const char* protocolName(int proto, size_t index = 0)
 {
-	map[SPPoseEuler] = "Position + Orientation (Euler)";
-	map[SPPoseQuaternion] = "Position + Orientation (Quaternion)";
-	map[SPPosePositions] = "Virtual Optical Marker Set";
-	map[SPJackProcessSimulate] = "Siemens Tecnomatix";
-	map[SPPoseUnity3D] = "Unity 3D";
-
-	map[SPMetaMoreMeta] = "Character Meta Data";
-	map[SPMetaScaling] = "Scaling Data";
+	return index == PROTOCOLNAMECOUNT ? ""
+		: PROTOCOLNAMES[index].proto == proto ? PROTOCOLNAMES[index].name
+		: protocolName(proto, index + 1);
+}
 
-	map[SPJointAngles] = "Joint Angles";
-	map[SPLinearSegmentKinematics] = "Linear Segment Kinematics";
-	map[SPAngularSegmentKinematics] = "Angular Segment Kinematics";
-	map[SPTrackerKinematics] = "Tracker Kinematics";
-	map[SPCenterOfMass] = "Center of Mass";
-	map[SPTimeCode] = "Time Code";
 }
 
 /*! Convert the StreamingProtocol to user frindly string name
+	\returns an empty string if \a proto is unknown
 */
-std::string Datagram::decode(StreamingProtocol proto) const
+const char* Datagram::decode(StreamingProtocol proto)
 {
-	if(m_packetsName.find(proto) != m_packetsName.end())
-	{
-		//element found;
-		return m_packetsName.find(proto)->second;
-	}
-	return std::string();	
-}
-
-void Datagram::convertFromYupToZup(float *vector) const
-{
-	// Covert the coordinates to Z-Up
-	float x = vector[0];		
-	float y = vector[1];		
-	float z = vector[2];		
-
-	vector[0] = z;
-	vector[1] = x;
-	vector[2] = y;
+	return protocolName(proto);
 }
@@ -30,12 +30,15 @@
 #include <memory>
 #include <iostream>
 #include <sstream>
-#include <map>
 #include <vector>
 #include <array>
 
 #include "streamer.h"
+#include "avatarinfo.h"
 #include "lsl_cpp.h"
+#include "outletregistry.h"
+#include "recordlayout.h"
+
 
 enum StreamingProtocol {
 	SPPoseEuler = 0x01,
@@ -63,11 +66,14 @@ class Datagram
 {
 public:
 	Datagram();
-	~Datagram();
+	virtual ~Datagram();
 
-	bool deserialize(const XsByteArray& arr);
+	bool deserialize(const uint8_t* data, size_t size);
 	void setDataCount(uint8_t c);
 	void setType(StreamingProtocol proto);
+	void setAvatarInfo(AvatarInfoTable *avatars);
+	void setTimestamp(double timestamp);
+	double timestamp() const;
 	int32_t messageType() const;
 	int32_t sampleCounter() const;
 	int32_t frameTime() const;
@@ -75,30 +81,172 @@ public:
 	uint8_t dataCount() const;
 	uint8_t datagramCounter() const;
 
-	static int messageType(const XsByteArray& arr);
-	std::string decode(StreamingProtocol proto) const;
+	static int messageType(const uint8_t* data, size_t size);
+	static const char* decode(StreamingProtocol proto);
 
-	void convertFromYupToZup(float *vector) const;
+	static void convertFromYupToZup(float *vector);
+	static float rad2deg(float radians);
 
 	void printHeader() const;
-	virtual void printData() const = 0;
+	virtual void printData() = 0;
+	virtual OutletRegistry *outlets();
+	virtual const float *sample(size_t &count);
 	
 protected:
-	virtual void deserializeData(Streamer &inputStreamer) = 0;
+	virtual bool deserializeData(Streamer &inputStreamer) = 0;
 	static const float EULERPOSITIONSCALE;
 
+	const AvatarInfo *avatarInfo() const;
+	AvatarInfoTable *avatarInfoTable() const;
+
+	template <typename Layout>
+	bool decodeRecords(Streamer &streamer, OutletRegistry &outlets);
+	template <typename Layout>
+	bool decodeRecords(Streamer &streamer, std::vector<float> &sample);
+	template <typename Layout>
+	const float *recordSample(OutletRegistry &outlets, size_t &count);
+	template <typename Layout>
+	void streamRecords(OutletRegistry &outlets);
+
+	// Field transforms for the RecordLayout descriptions of the kinematics records
+	struct Rad2Deg
+	{
+		template <size_t Count>
+		static void apply(float* values)
+		{
+			for (size_t i = 0; i < Count; i++)
+				values[i] = rad2deg(values[i]);
+		}
+	};
+
+	struct PositionScale
+	{
+		template <size_t Count>
+		static void apply(float* values)
+		{
+			for (size_t i = 0; i < Count; i++)
+				values[i] /= EULERPOSITIONSCALE;
+		}
+	};
+
+	struct YupToZup
+	{
+		template <size_t Count>
+		static void apply(float* values)
+		{
+			static_assert(Count == 3, "only a 3-component vector can be converted to Z-Up");
+			convertFromYupToZup(values);
+		}
+	};
+
 private:
-	std::string m_header;
+	int m_type;
 	int32_t m_sampleCounter;
 	int32_t m_frameTime;
 	uint8_t m_avatarId;
 	uint8_t m_dataCount;
 	uint8_t m_dgramCounter;
 	int m_dataSize;
+	AvatarInfoTable *m_avatars;
+	double m_timestamp;
 
 	int getDataSize() const;
-	void initMap(std::map<int, std::string> &map);
-	std::map<int, std::string> m_packetsName;
+
+	template <typename Layout>
+	bool hasRecords(const Streamer &streamer) const;
+	template <typename Layout>
+	OutletRegistry::Outlet &recordOutlet(OutletRegistry &outlets) const;
 };
 
+/*! \returns true if the packet has records and \a streamer holds all dataCount() of them */
+template <typename Layout>
+bool Datagram::hasRecords(const Streamer &streamer) const
+{
+	// reject empty and truncated packets up front, the records are decoded unchecked
+	return dataCount() != 0 && streamer.canRead(dataCount() * Layout::size());
+}
+
+/*! \returns the outlet in \a outlets of the avatar, for dataCount() records of \a Layout
+
+	The outlet of the avatar is created on its first packet and re-created when the number of records changes,
+	its sample buffer is reused for every following sample.
+*/
+template <typename Layout>
+OutletRegistry::Outlet &Datagram::recordOutlet(OutletRegistry &outlets) const
+{
+	return outlets.outlet(avatarId(), dataCount(), Layout::channels(), avatarInfo());
+}
+
+/*! Decode the dataCount() records of \a Layout in \a streamer into the sample buffer of the outlet of the avatar
+
+	\returns false if the packet is empty or truncated, no outlet is created for it then
+*/
+template <typename Layout>
+bool Datagram::decodeRecords(Streamer &streamer, OutletRegistry &outlets)
+{
+	if (!hasRecords<Layout>(streamer))
+		return false;
+
+	// resizing keeps the capacity of the buffer
+	std::vector<float> &sample = recordOutlet<Layout>(outlets).sample;
+	sample.resize(dataCount() * Layout::channels());
+	streamer.readLayout<Layout>(sample.data(), dataCount());
+	return true;
+}
+
+/*! Decode the dataCount() records of \a Layout in \a streamer into \a sample, which keeps its capacity
+
+	\returns false if the packet is empty or truncated
+*/
+template <typename Layout>
+bool Datagram::decodeRecords(Streamer &streamer, std::vector<float> &sample)
+{
+	if (!hasRecords<Layout>(streamer))
+		return false;
+
+	sample.resize(dataCount() * Layout::channels());
+	streamer.readLayout<Layout>(sample.data(), dataCount());
+	return true;
+}
+
+/*! \returns the \a count records of \a Layout decoded last, they live in the sample buffer of the outlet of the avatar */
+template <typename Layout>
+const float *Datagram::recordSample(OutletRegistry &outlets, size_t &count)
+{
+	const std::vector<float> &values = recordOutlet<Layout>(outlets).sample;
+	count = values.size();
+	return values.data();
+}
+
+/*! Push the records of \a Layout decoded last to the outlet of the avatar */
+template <typename Layout>
+void Datagram::streamRecords(OutletRegistry &outlets)
+{
+	OutletRegistry::Outlet &out = recordOutlet<Layout>(outlets);
+	out.push(out.sample.data(), timestamp());
+}
+
+/*! Convert the Y-Up \a vector to Z-Up in place
+
+	Both are defined here so the RecordLayout decode kernels can inline them.
+*/
+inline void Datagram::convertFromYupToZup(float *vector)
+{
+	// Covert the coordinates to Z-Up
+	float x = vector[0];
+	float y = vector[1];
+	float z = vector[2];
+
+	vector[0] = z;
+	vector[1] = x;
+	vector[2] = y;
+}
+
+/*! Convert \a radians to degrees
+*/
+inline float Datagram::rad2deg(float radians)
+{
+	return static_cast<float>(radians * (180.0 / 3.14159265358979323846));
+}
+
 #endif
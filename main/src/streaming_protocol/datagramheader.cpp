@@ -0,0 +1,84 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "datagramheader.h"
+#include <array>
+
+/*! \class DatagramHeader
+	\brief A read-only view of the 24 byte header of a datagram
+
+	The header is laid out as follows.
+
+	6 bytes ID string "MXTP##", where ## is the message type as two hexadecimal digits
+	4 bytes sample counter
+	1 byte datagram counter
+	1 byte number of items
+	4 bytes time code
+	1 byte character ID
+	7 bytes reserved for future use
+
+	Multi-byte values are big endian. The view decodes the fields directly from the received bytes, it
+	does not copy or allocate.
+*/
+
+namespace {
+
+/*! Build the table that maps an ASCII character to its hexadecimal digit value, or -1 */
+std::array<int8_t, 256> makeHexDigitTable()
+{
+	std::array<int8_t, 256> table;
+	table.fill(-1);
+	for (int c = '0'; c <= '9'; c++)
+		table[c] = (int8_t)(c - '0');
+	for (int c = 'a'; c <= 'f'; c++)
+		table[c] = (int8_t)(c - 'a' + 10);
+	for (int c = 'A'; c <= 'F'; c++)
+		table[c] = (int8_t)(c - 'A' + 10);
+	return table;
+}
+
+const std::array<int8_t, 256> HEXDIGITS = makeHexDigitTable();
+
+}
+
+/*! Construct a view on the \a size bytes at \a data
+
+	The header is valid when the data holds at least a full header, starts with "MXTP" and the message
+	type consists of two hexadecimal digits. The fields of an invalid header must not be accessed.
+*/
+DatagramHeader::DatagramHeader(const uint8_t* data, size_t size)
+	: m_data(data)
+	, m_size(size)
+	, m_type(-1)
+{
+	if (size < SIZE || data[0] != 'M' || data[1] != 'X' || data[2] != 'T' || data[3] != 'P')
+		return;
+
+	int high = HEXDIGITS[data[4]];
+	int low = HEXDIGITS[data[5]];
+	if (high >= 0 && low >= 0)
+		m_type = high << 4 | low;
+}
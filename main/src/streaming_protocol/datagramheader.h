@@ -0,0 +1,64 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef DATAGRAMHEADER_H
+#define DATAGRAMHEADER_H
+
+#include <cstdint>
+#include <cstddef>
+
+class DatagramHeader
+{
+public:
+	static const size_t SIZE = 24;
+
+	DatagramHeader(const uint8_t* data, size_t size);
+
+	bool isValid() const { return m_type >= 0; }
+	int messageType() const { return m_type; }
+	int32_t sampleCounter() const { return readInt32(6); }
+	uint8_t datagramCounter() const { return m_data[10]; }
+	uint8_t dataCount() const { return m_data[11]; }
+	int32_t frameTime() const { return readInt32(12); }
+	uint8_t avatarId() const { return m_data[16]; }
+
+	const uint8_t* data() const { return m_data; }
+	const uint8_t* payload() const { return m_data + SIZE; }
+	size_t payloadSize() const { return m_size - SIZE; }
+
+private:
+	int32_t readInt32(size_t offset) const
+	{
+		return (int32_t)((uint32_t)m_data[offset] << 24 | (uint32_t)m_data[offset + 1] << 16
+			| (uint32_t)m_data[offset + 2] << 8 | (uint32_t)m_data[offset + 3]);
+	}
+
+	const uint8_t* m_data;
+	size_t m_size;
+	int m_type;
+};
+
+#endif
@@ -25,8 +25,7 @@
 */
 
 #include "eulerdatagram.h"
-#include <xsens/xsquaternion.h>
-#include <xsens/xseuler.h>
+#include <cmath>
 
 /*! \class EulerDatagram
   \brief a Position & Euler orientation pose datagram (type 01)
@@ -50,6 +49,7 @@
 /*! Constructor */
 EulerDatagram::EulerDatagram()
 	: Datagram()
+	, m_outlets("EulerDatagram", "ed")
 {
 	setType(SPPoseEuler);
 }
@@ -62,87 +62,72 @@ EulerDatagram::~EulerDatagram()
 /*! Deserialize the data from \a arr
 	\sa serializeData
 */
-void EulerDatagram::deserializeData(Streamer &inputStreamer)
+bool EulerDatagram::deserializeData(Streamer &inputStreamer)
 {
-	Streamer* streamer = &inputStreamer;
+	static_assert(Layout::size() == 28, "Layout must match the 28 byte segment layout");
 
-	for (int i = 0; i < dataCount(); i++)
-	{
-		Kinematics kin;
-		float orientation[4];
-		float rotation[3];
-		XsQuaternion quaternion;
-		XsQuaternion tempQuat;
-
-		// Store the segement Id -> 4 byte 
-		streamer->read(kin.segmentId);
-
-		// Store the position in a Vector. The coordinates use a Y-Up
-		for (int k = 0; k < 3; k++)
-			streamer->read((float)kin.pos[k]);
-
-		for (int k = 0; k < 3; k++)
-			kin.pos[k] /= EULERPOSITIONSCALE;
-
-		// Covert the coordinates to Z-Up
-		convertFromYupToZup(kin.pos);
-
-		// The rotation is based to the coordinates Y-Up
-		for (int k = 0; k < 3; k++)
-			streamer->read((float)rotation[k]);
-		
-		// create Euler vector based from the rotation cordinates
-		XsEuler euler(rotation[0], rotation[1], rotation[2]);
-
-		// convert the Euler vector to quaternion
-		quaternion.fromEulerAngles(euler);
-
-		// create a quaternion with the inverted components (x,y,z)
-		tempQuat = XsQuaternion(quaternion[0], quaternion[3], quaternion[1], quaternion[2]);
+	// Segment ID, Position (3 x 4 byte) and Rotation (3 x 4 byte) are all big endian 32 bit fields
+	return decodeRecords<Layout>(inputStreamer, m_outlets);
+}
 
-		// covert from Euler to Quaternion again
-		euler.fromQuaternion(tempQuat);
+/*! Convert the Y-Up Euler angles \a src (degrees) to Z-Up Euler angles \a dst (degrees)
 
-		kin.rotation[0] = euler[0];
-		kin.rotation[1] = euler[1];
-		kin.rotation[2] = euler[2];
+	The angles are converted to a quaternion, the vector components are permuted (x,y,z) -> (z,x,y)
+	and the result is converted back to Euler angles, using the same conventions as XsQuaternion::fromEulerAngles
+	and XsEuler::fromQuaternion.
+*/
+void EulerDatagram::convertEulerFromYupToZup(const float *src, float *dst)
+{
+	const double deg2rad = 3.14159265358979323846 / 180.0;
+	const double rad2deg = 180.0 / 3.14159265358979323846;
+
+	// Euler to quaternion
+	double cx = std::cos(src[0] * deg2rad * 0.5), sx = std::sin(src[0] * deg2rad * 0.5);
+	double cy = std::cos(src[1] * deg2rad * 0.5), sy = std::sin(src[1] * deg2rad * 0.5);
+	double cz = std::cos(src[2] * deg2rad * 0.5), sz = std::sin(src[2] * deg2rad * 0.5);
+
+	double w = cx * cy * cz + sx * sy * sz;
+	double x = sx * cy * cz - cx * sy * sz;
+	double y = cx * sy * cz + sx * cy * sz;
+	double z = cx * cy * sz - sx * sy * cz;
+
+	// create a quaternion with the inverted components (x,y,z)
+	double qw = w, qx = z, qy = x, qz = y;
+
+	// quaternion to Euler
+	double sqw = qw * qw;
+	double dphi = 2.0 * (sqw + qz * qz) - 1.0;
+	double dpsi = 2.0 * (sqw + qx * qx) - 1.0;
+	double sinTheta = 2.0 * (qx * qz - qw * qy);
+	if (sinTheta > 1.0)
+		sinTheta = 1.0;
+	else if (sinTheta < -1.0)
+		sinTheta = -1.0;
+
+	dst[0] = static_cast<float>(rad2deg * std::atan2(2.0 * (qy * qz + qw * qx), dphi));
+	dst[1] = static_cast<float>(-rad2deg * std::asin(sinTheta));
+	dst[2] = static_cast<float>(rad2deg * std::atan2(2.0 * (qx * qy + qw * qz), dpsi));
+}
 
-		m_data.push_back(kin);
-	}
+/*! \returns the outlets of this datagram type */
+OutletRegistry *EulerDatagram::outlets()
+{
+	return &m_outlets;
 }
 
-lsl::stream_info EulerDatagram::info[2] = {
-	lsl::stream_info{"EulerDatagram1", "MoCap", 23 * (3 + 3), lsl::IRREGULAR_RATE, lsl::cf_float32, "ed1"},
-	lsl::stream_info{"EulerDatagram2", "MoCap", 23 * (3 + 3), lsl::IRREGULAR_RATE, lsl::cf_float32, "ed2"}
-};
-
-// Create the streams with that stream info
-lsl::stream_outlet EulerDatagram::outlet[2] = {
-	{EulerDatagram::info[0]},
-	{EulerDatagram::info[1]},
-};
-
-std::vector<float> EulerDatagram::alignData() const {
-	std::vector<float> ret;
-	for (auto seg : m_data) {
-		for (auto p : seg.pos) {
-			ret.push_back(p);
-		}
-		for (auto r : seg.rotation) {
-			ret.push_back(r);
-		}
-	}
-	return ret;
+/*! \returns the decoded records */
+const float *EulerDatagram::sample(size_t &count)
+{
+	return recordSample<Layout>(m_outlets, count);
 }
 
-void EulerDatagram::streamData() const{
-	std::vector<float> ret = alignData();
-	outlet[avatarId()].push_sample(ret);
+void EulerDatagram::streamData() {
+	streamRecords<Layout>(m_outlets);
 }
 
 /*! Print Data datagram in a formated why
 */
-void EulerDatagram::printData() const
+void EulerDatagram::printData()
 {
 	streamData();
 }
@@ -28,29 +28,45 @@
 #define EULERATAGRAM_H
 
 #include "datagram.h"
+#include "outletregistry.h"
+#include "recordlayout.h"
 
 class EulerDatagram : public Datagram {
 public:
 	EulerDatagram();
 	virtual ~EulerDatagram();
-	virtual void printData() const override;
+	virtual void printData() override;
+	virtual OutletRegistry *outlets() override;
+	virtual const float *sample(size_t &count) override;
 
 protected:
-	virtual void deserializeData(Streamer &inputStreamer) override;
+	virtual bool deserializeData(Streamer &inputStreamer) override;
 
 private:
-	struct Kinematics {
-		int32_t segmentId;
-		float pos[3];
-		float rotation[3];
+	static void convertEulerFromYupToZup(const float *src, float *dst);
+
+	/*! Convert a Y-Up Euler rotation (degrees) to Z-Up */
+	struct EulerYupToZup
+	{
+		template <size_t Count>
+		static void apply(float* values)
+		{
+			static_assert(Count == 3, "an Euler rotation has 3 components");
+			convertEulerFromYupToZup(values, values);
+		}
 	};
 
-	std::vector<Kinematics> m_data;
+	/*! One segment on the wire, the position is scaled to meters and both fields are converted to Z-Up */
+	typedef RecordLayout::Record<
+		RecordLayout::Skip<1>,		// segment id
+		RecordLayout::Float<3, RecordLayout::Chain<PositionScale, YupToZup>>,		// position
+		RecordLayout::Float<3, EulerYupToZup>		// rotation
+	> Layout;
+
+	// the outlets per avatar, the records are decoded straight into their sample buffers
+	OutletRegistry m_outlets;
 public:
-	std::vector<float> alignData() const;
-	void streamData() const;
-	static lsl::stream_info info[2];
-	static lsl::stream_outlet outlet[2];
+	void streamData();
 };
 
 #endif
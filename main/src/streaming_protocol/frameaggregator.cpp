@@ -0,0 +1,313 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "frameaggregator.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+/*! \class FrameAggregator
+  \brief One LSL sample per frame for the message types that are streamed together
+
+  The sender emits every enabled message type as its own datagram, all with the sample counter of the frame.
+  The aggregator collects the decoded samples of the aggregated types with the same avatar and sample counter
+  and pushes them as one sample on the CombinedFrame outlet of the avatar, with the channels of each type in
+  the order of the policy. The outlets of the individual types keep streaming as before.
+
+  A frame is pushed as soon as all types arrived. A frame that misses a type after the wait time, or whose
+  slot is needed by a newer frame, is pushed with NaN in the channels of the missing types.
+
+  The frames of an avatar are pushed in the order of their sample counters, so the combined outlet never goes
+  back in time: an older frame that is still being collected is pushed before a newer one, and parts of a frame
+  at or before the last pushed one are late and dropped. A sample counter far behind the last pushed one means
+  the sender restarted, the aggregator then starts over.
+ */
+
+// the wait for the missing types of a frame when the setting does not give one
+static const int DEFAULTWAIT_MS = 20;
+
+// the received types of a frame are a bit mask
+static const size_t MAXTYPES = 32;
+
+// a sample counter this far behind the last pushed frame is a restart of the sender, not a late part
+static const int32_t RESYNCDISTANCE = 1000;
+
+/*! Constructor, the default aggregates nothing */
+AggregationPolicy::AggregationPolicy()
+	: milliseconds(DEFAULTWAIT_MS)
+{
+}
+
+/*! \returns true if at least one message type is aggregated */
+bool AggregationPolicy::isEnabled() const
+{
+	return !types.empty();
+}
+
+/*! Parse a command line \a setting of the form type[,type]...[:milliseconds]
+
+	The types are the hexadecimal message types, as in the MXTP header (e.g. 02,21,22,23).
+	\returns false if the setting could not be parsed
+*/
+bool AggregationPolicy::parse(const std::string &setting)
+{
+	std::vector<int> parsed;
+	int wait = DEFAULTWAIT_MS;
+	const char *str = setting.c_str();
+
+	while (true)
+	{
+		unsigned int type = 0;
+		int length = 0;
+		if (sscanf(str, "%2x%n", &type, &length) != 1)
+			return false;
+		for (int existing : parsed)
+			if (existing == (int)type)
+				return false;
+		parsed.push_back((int)type);
+		str += length;
+
+		if (*str != ',')
+			break;
+		str++;
+	}
+
+	if (*str == ':' && (sscanf(str + 1, "%d", &wait) != 1 || wait < 0))
+		return false;
+	else if (*str != ':' && *str != 0)
+		return false;
+
+	if (parsed.size() > MAXTYPES)
+		return false;
+
+	types = parsed;
+	milliseconds = wait;
+	return true;
+}
+
+/*! Constructor */
+FrameAggregator::Slot::Slot()
+	: used(false)
+	, sampleCounter(0)
+	, received(0)
+	, timestamp(0)
+	, receiveTime(0)
+{
+}
+
+/*! Constructor */
+FrameAggregator::Avatar::Avatar()
+	: pushed(false)
+	, lastPushed(0)
+{
+}
+
+/*! Constructor
+	\param policy The message types to combine and the time a frame waits for missing types
+	\param avatars The names of the avatars for the stream descriptions, or nullptr
+*/
+FrameAggregator::FrameAggregator(const AggregationPolicy &policy, const AvatarInfoTable *avatars)
+	: m_policy(policy)
+	, m_allTypes(0)
+	, m_outlets("CombinedFrame", "cf")
+	, m_avatarInfo(avatars)
+	, m_completeCount(0)
+	, m_partialCount(0)
+	, m_lateCount(0)
+{
+	m_typeIndex.fill(-1);
+	for (size_t i = 0; i < m_policy.types.size() && i < MAXTYPES; i++)
+	{
+		m_typeIndex[m_policy.types[i] & 0xFF] = (int8_t)i;
+		m_allTypes |= 1u << i;
+	}
+}
+
+/*! \returns true if samples of \a messageType are combined */
+bool FrameAggregator::isAggregated(int messageType) const
+{
+	return m_typeIndex[messageType & 0xFF] >= 0;
+}
+
+/*! Add the \a count decoded \a values of a datagram of \a messageType
+
+	\param avatarId The avatar of the datagram
+	\param sampleCounter The frame of the datagram
+	\param timestamp The capture time of the frame, the combined sample gets the one of its first part
+	\param receiveTime The local clock time the datagram was received, the wait of the frame starts at its first part
+*/
+void FrameAggregator::add(uint8_t avatarId, int messageType, int32_t sampleCounter, const float *values,
+	size_t count, double timestamp, double receiveTime)
+{
+	int index = m_typeIndex[messageType & 0xFF];
+	if (index < 0)
+		return;
+
+	expire(receiveTime);
+
+	std::unique_ptr<Avatar> &avatar = m_avatars[avatarId];
+	if (!avatar)
+	{
+		avatar.reset(new Avatar);
+		avatar->channels.assign(m_policy.types.size(), -1);
+		for (Slot &slot : avatar->slots)
+			slot.values.resize(m_policy.types.size());
+		m_avatarIds.push_back(avatarId);
+	}
+
+	if (avatar->pushed)
+	{
+		int32_t behind = (int32_t)((uint32_t)avatar->lastPushed - (uint32_t)sampleCounter);
+		if (behind > RESYNCDISTANCE)
+		{
+			for (Slot &open : avatar->slots)
+				open.used = false;
+			avatar->pushed = false;
+		}
+		else if (behind >= 0)
+		{
+			m_lateCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	// the slot is fixed by the sample counter, so a frame is found without searching and a newer frame
+	// reuses the slot of the frame SLOTCOUNT before it
+	Slot &slot = avatar->slots[(uint32_t)sampleCounter % SLOTCOUNT];
+	int32_t age = (int32_t)((uint32_t)sampleCounter - (uint32_t)slot.sampleCounter);
+	if (slot.used && age < 0)
+	{
+		m_lateCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	if (slot.used && age > 0)
+		push(avatarId, *avatar, slot);
+
+	if (!slot.used)
+	{
+		slot.used = true;
+		slot.sampleCounter = sampleCounter;
+		slot.received = 0;
+		slot.timestamp = timestamp;
+		slot.receiveTime = receiveTime;
+	}
+
+	uint32_t bit = 1u << index;
+	if (slot.received & bit)
+		return;
+
+	slot.values[index].assign(values, values + count);
+	slot.received |= bit;
+	avatar->channels[index] = (int)count;
+
+	if (slot.received == m_allTypes)
+		push(avatarId, *avatar, slot);
+}
+
+/*! Push the frames whose first part was received longer than the wait time before local clock time \a now */
+void FrameAggregator::expire(double now)
+{
+	double wait = m_policy.milliseconds * 1e-3;
+	for (uint8_t avatarId : m_avatarIds)
+	{
+		Avatar &avatar = *m_avatars[avatarId];
+		for (Slot &slot : avatar.slots)
+		{
+			if (slot.used && now - slot.receiveTime > wait)
+				push(avatarId, avatar, slot);
+		}
+	}
+}
+
+/*! \returns the CombinedFrame outlets */
+OutletRegistry *FrameAggregator::outlets()
+{
+	return &m_outlets;
+}
+
+/*! Push the frame in \a slot of avatar \a avatarId and free the slot, after the older frames that are still open */
+void FrameAggregator::push(uint8_t avatarId, Avatar &avatar, Slot &slot)
+{
+	for (;;)
+	{
+		Slot *oldest = nullptr;
+		for (Slot &open : avatar.slots)
+		{
+			if (!open.used || (int32_t)((uint32_t)open.sampleCounter - (uint32_t)slot.sampleCounter) >= 0)
+				continue;
+			if (!oldest || (int32_t)((uint32_t)open.sampleCounter - (uint32_t)oldest->sampleCounter) < 0)
+				oldest = &open;
+		}
+		if (!oldest)
+			break;
+		send(avatarId, avatar, *oldest);
+	}
+	send(avatarId, avatar, slot);
+}
+
+/*! Push the frame in \a slot of avatar \a avatarId and free the slot
+
+	The missing types are filled with NaN. Until every type was received once the layout of the combined
+	sample is unknown, such a frame is dropped.
+*/
+void FrameAggregator::send(uint8_t avatarId, Avatar &avatar, Slot &slot)
+{
+	slot.used = false;
+	avatar.pushed = true;
+	avatar.lastPushed = slot.sampleCounter;
+	bool complete = slot.received == m_allTypes;
+	if (complete)
+		m_completeCount.fetch_add(1, std::memory_order_relaxed);
+	else
+		m_partialCount.fetch_add(1, std::memory_order_relaxed);
+
+	int channelCount = 0;
+	for (int channels : avatar.channels)
+	{
+		if (channels < 0)
+			return;
+		channelCount += channels;
+	}
+
+	const AvatarInfo *info = m_avatarInfo ? &m_avatarInfo->info(avatarId) : nullptr;
+	OutletRegistry::Outlet &out = m_outlets.outlet(avatarId, 1, channelCount, info);
+	out.sample.resize(channelCount);
+
+	float *dst = out.sample.data();
+	for (size_t i = 0; i < avatar.channels.size(); i++)
+	{
+		const std::vector<float> &values = slot.values[i];
+		size_t channels = (size_t)avatar.channels[i];
+		if ((slot.received & (1u << i)) && values.size() == channels)
+			memcpy(dst, values.data(), channels * sizeof(float));
+		else
+			std::fill(dst, dst + channels, std::numeric_limits<float>::quiet_NaN());
+		dst += channels;
+	}
+
+	out.push(out.sample.data(), slot.timestamp);
+}
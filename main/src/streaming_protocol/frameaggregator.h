@@ -0,0 +1,113 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef FRAMEAGGREGATOR_H
+#define FRAMEAGGREGATOR_H
+
+#include "outletregistry.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*! Which message types are combined into one sample per frame, and how long a frame waits for them */
+struct AggregationPolicy
+{
+	AggregationPolicy();
+
+	bool isEnabled() const;
+	bool parse(const std::string &setting);
+
+	// the hexadecimal message types in the order their channels appear in the combined sample
+	std::vector<int> types;
+	// push an incomplete frame once its first part is this old
+	int milliseconds;
+};
+
+/*! Combines the samples of several message types that belong to the same frame into one sample */
+class FrameAggregator
+{
+public:
+	FrameAggregator(const AggregationPolicy &policy = AggregationPolicy(), const AvatarInfoTable *avatars = nullptr);
+
+	bool isAggregated(int messageType) const;
+	void add(uint8_t avatarId, int messageType, int32_t sampleCounter, const float *values, size_t count,
+		double timestamp, double receiveTime);
+	void expire(double now);
+	OutletRegistry *outlets();
+
+	// statistics, safe to read from any thread
+	size_t completeCount() const { return m_completeCount.load(std::memory_order_relaxed); }
+	size_t partialCount() const { return m_partialCount.load(std::memory_order_relaxed); }
+	size_t lateCount() const { return m_lateCount.load(std::memory_order_relaxed); }
+
+private:
+	static const size_t SLOTCOUNT = 8;
+
+	/*! A frame that is being collected, the slot is picked by the low bits of its sample counter */
+	struct Slot
+	{
+		Slot();
+
+		bool used;
+		int32_t sampleCounter;
+		uint32_t received;
+		double timestamp;
+		double receiveTime;
+		std::vector<std::vector<float>> values;
+	};
+
+	/*! The frames of one avatar and the channel count of each type as last received */
+	struct Avatar
+	{
+		Avatar();
+
+		std::array<Slot, SLOTCOUNT> slots;
+		std::vector<int> channels;
+
+		// the sample counter of the last pushed frame, once a frame was pushed
+		bool pushed;
+		int32_t lastPushed;
+	};
+
+	void push(uint8_t avatarId, Avatar &avatar, Slot &slot);
+	void send(uint8_t avatarId, Avatar &avatar, Slot &slot);
+
+	AggregationPolicy m_policy;
+	std::array<int8_t, 256> m_typeIndex;
+	uint32_t m_allTypes;
+	OutletRegistry m_outlets;
+	const AvatarInfoTable *m_avatarInfo;
+	std::array<std::unique_ptr<Avatar>, 256> m_avatars;
+	std::vector<uint8_t> m_avatarIds;
+
+	std::atomic<size_t> m_completeCount;
+	std::atomic<size_t> m_partialCount;
+	std::atomic<size_t> m_lateCount;
+};
+
+#endif
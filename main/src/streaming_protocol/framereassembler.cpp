@@ -0,0 +1,181 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "framereassembler.h"
+#include <cstring>
+
+// the datagram counter of the last part of a frame, and of a frame that was not split
+static const uint8_t LASTPART = 0x80;
+
+/*! Constructor
+	\param slotCount The number of frames that can be reassembled at the same time
+	\param timeout The time in seconds after the first received part of a frame at which it is dropped
+*/
+FrameReassembler::FrameReassembler(size_t slotCount, double timeout)
+	: m_slots(slotCount < 1 ? 1 : slotCount)
+	, m_timeout(timeout)
+	, m_frameReceiveTime(0)
+	, m_completedCount(0)
+	, m_expiredCount(0)
+{
+	for (Slot &s : m_slots)
+		release(s);
+}
+
+/*! \returns true if the datagram with \a header is a part of a frame that was split up */
+bool FrameReassembler::isSplit(const DatagramHeader &header)
+{
+	return header.datagramCounter() != LASTPART;
+}
+
+/*! Add the part of a frame with \a header that was received at local clock time \a receiveTime
+
+	When this completes the frame, it is available through frame() as a single datagram with the header of
+	its parts, the items of all parts and the payloads of all parts in order, until the next call.
+	\returns true if the frame is complete
+*/
+bool FrameReassembler::add(const DatagramHeader &header, double receiveTime)
+{
+	expire(receiveTime);
+
+	Slot &s = slot(header, receiveTime);
+	size_t index = header.datagramCounter() & ~LASTPART;
+	if (s.received[index])
+		return false;
+
+	s.received[index] = true;
+	s.partCount++;
+	s.offsets[index] = (uint32_t)s.payload.size();
+	s.sizes[index] = (uint32_t)header.payloadSize();
+	s.dataCounts[index] = header.dataCount();
+	s.payload.insert(s.payload.end(), header.payload(), header.payload() + header.payloadSize());
+	if (header.datagramCounter() & LASTPART)
+		s.lastIndex = (int)index;
+
+	if (s.lastIndex < 0 || s.partCount != (size_t)s.lastIndex + 1)
+		return false;
+
+	bool complete = assemble(s);
+	release(s);
+	if (complete)
+		m_completedCount.fetch_add(1, std::memory_order_relaxed);
+	else
+		m_expiredCount.fetch_add(1, std::memory_order_relaxed);
+	return complete;
+}
+
+/*! Drop the frames whose first part was received longer than the timeout before local clock time \a now */
+void FrameReassembler::expire(double now)
+{
+	for (Slot &s : m_slots)
+	{
+		if (s.used && now - s.receiveTime > m_timeout)
+		{
+			release(s);
+			m_expiredCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+/*! \returns the slot of the frame of \a header, a free one if this is its first part
+
+	When all slots are in use, the frame that started receiving first is dropped to make room.
+*/
+FrameReassembler::Slot &FrameReassembler::slot(const DatagramHeader &header, double receiveTime)
+{
+	Slot *oldest = nullptr;
+	Slot *available = nullptr;
+	for (Slot &s : m_slots)
+	{
+		if (!s.used)
+		{
+			if (!available)
+				available = &s;
+			continue;
+		}
+		if (s.avatarId == header.avatarId() && s.messageType == header.messageType()
+			&& s.sampleCounter == header.sampleCounter())
+			return s;
+		if (!oldest || s.receiveTime < oldest->receiveTime)
+			oldest = &s;
+	}
+
+	if (!available)
+	{
+		release(*oldest);
+		m_expiredCount.fetch_add(1, std::memory_order_relaxed);
+		available = oldest;
+	}
+
+	Slot &s = *available;
+	s.used = true;
+	s.avatarId = header.avatarId();
+	s.messageType = header.messageType();
+	s.sampleCounter = header.sampleCounter();
+	s.receiveTime = receiveTime;
+	memcpy(s.header.data(), header.data(), DatagramHeader::SIZE);
+	return s;
+}
+
+/*! Join the parts of the complete frame in \a slot into the frame buffer
+
+	The number of items of a datagram is a single byte, so a frame with more items can not be represented.
+	\returns false if the frame has too many items
+*/
+bool FrameReassembler::assemble(Slot &slot)
+{
+	size_t dataCount = 0;
+	for (int i = 0; i <= slot.lastIndex; i++)
+		dataCount += slot.dataCounts[i];
+	if (dataCount > 0xFF)
+		return false;
+
+	m_frame.resize(DatagramHeader::SIZE + slot.payload.size());
+	memcpy(m_frame.data(), slot.header.data(), DatagramHeader::SIZE);
+	// the datagram counter and number of items of the header
+	m_frame[10] = LASTPART;
+	m_frame[11] = (uint8_t)dataCount;
+
+	uint8_t *payload = m_frame.data() + DatagramHeader::SIZE;
+	for (int i = 0; i <= slot.lastIndex; i++)
+	{
+		memcpy(payload, slot.payload.data() + slot.offsets[i], slot.sizes[i]);
+		payload += slot.sizes[i];
+	}
+
+	m_frameReceiveTime = slot.receiveTime;
+	return true;
+}
+
+/*! Free \a slot for the next frame, its payload buffer keeps its capacity */
+void FrameReassembler::release(Slot &slot)
+{
+	slot.used = false;
+	slot.lastIndex = -1;
+	slot.partCount = 0;
+	slot.received.reset();
+	slot.payload.clear();
+}
@@ -0,0 +1,93 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef FRAMEREASSEMBLER_H
+#define FRAMEREASSEMBLER_H
+
+#include "datagramheader.h"
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <vector>
+
+/*! Joins the datagrams of a frame that the sender split up into one datagram
+
+	The parts of a frame share the avatar, message type and sample counter, and carry their index in the
+	datagram counter, with the high bit set on the last one. Frames that are being received occupy one slot of
+	a fixed table, a frame that does not complete within the timeout, or is pushed out by a newer frame when
+	the table is full, is dropped.
+*/
+class FrameReassembler
+{
+public:
+	FrameReassembler(size_t slotCount = 32, double timeout = 0.1);
+
+	static bool isSplit(const DatagramHeader &header);
+
+	bool add(const DatagramHeader &header, double receiveTime);
+	void expire(double now);
+
+	const uint8_t* frame() const { return m_frame.data(); }
+	size_t frameSize() const { return m_frame.size(); }
+	double frameReceiveTime() const { return m_frameReceiveTime; }
+
+	// statistics, safe to read from any thread
+	size_t completedCount() const { return m_completedCount.load(std::memory_order_relaxed); }
+	size_t expiredCount() const { return m_expiredCount.load(std::memory_order_relaxed); }
+
+private:
+	static const size_t MAXPARTS = 128;
+
+	struct Slot
+	{
+		bool used;
+		uint8_t avatarId;
+		int messageType;
+		int32_t sampleCounter;
+		double receiveTime;
+		int lastIndex;
+		size_t partCount;
+		std::bitset<MAXPARTS> received;
+		std::array<uint32_t, MAXPARTS> offsets;
+		std::array<uint32_t, MAXPARTS> sizes;
+		std::array<uint8_t, MAXPARTS> dataCounts;
+		std::array<uint8_t, DatagramHeader::SIZE> header;
+		std::vector<uint8_t> payload;
+	};
+
+	Slot &slot(const DatagramHeader &header, double receiveTime);
+	bool assemble(Slot &slot);
+	void release(Slot &slot);
+
+	std::vector<Slot> m_slots;
+	double m_timeout;
+	std::vector<uint8_t> m_frame;
+	double m_frameReceiveTime;
+	std::atomic<size_t> m_completedCount;
+	std::atomic<size_t> m_expiredCount;
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "jitterbuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+/*! \class JitterBuffer
+  \brief An even cadence for streams that arrive in bursts
+
+  Samples are held back and pushed at their capture timestamp plus the playout delay. The timestamps come
+  from the SenderClock, which maps the frame times of the sender to the local clock, so the samples leave at
+  the rate they were captured no matter how the network bunched them up. Samples are kept in timestamp
+  order, for one stream that is the order of the sample counters.
+
+  The playout delay follows the transit time of the samples, the time between their capture timestamp and
+  their arrival. Its mean and variance are tracked with the 1/16 gain of the RTP interarrival jitter estimate,
+  and the delay is the mean plus four standard deviations, limited to the range of the policy. A sample that
+  arrives after its playout time is an underrun and is pushed right away. A sample that arrives when the
+  buffer is full is an overrun, the oldest sample is then pushed early to make room.
+ */
+
+// the samples one buffer can hold back, at 240 Hz this is over half a second
+static const size_t CAPACITY = 128;
+
+// the weight of a new transit time in its running mean and variance
+static const double TRANSITGAIN = 1.0 / 16.0;
+
+// the playout delay covers the mean transit time plus this many standard deviations
+static const double DELAYDEVIATIONS = 4.0;
+
+/*! Constructor, the default disables the jitter buffer
+	\param minimumMilliseconds The lowest playout delay, also the delay before the first transit time is known
+	\param maximumMilliseconds The highest playout delay, raised to the minimum if it is lower
+*/
+JitterPolicy::JitterPolicy(int minimumMilliseconds, int maximumMilliseconds)
+	: minimumMilliseconds(minimumMilliseconds < 0 ? 0 : minimumMilliseconds)
+	, maximumMilliseconds(std::max(maximumMilliseconds, this->minimumMilliseconds))
+{
+}
+
+/*! \returns true if samples are held back */
+bool JitterPolicy::isEnabled() const
+{
+	return maximumMilliseconds > 0;
+}
+
+/*! Parse a command line \a setting of the form minimum[:maximum], in milliseconds
+
+	Without a maximum the playout delay is fixed at the minimum.
+	\returns false if the setting could not be parsed
+*/
+bool JitterPolicy::parse(const std::string &setting)
+{
+	int minimum = 0, maximum = 0;
+	int fields = sscanf(setting.c_str(), "%d:%d", &minimum, &maximum);
+	if (fields < 1 || minimum < 0 || (fields == 2 && maximum < minimum))
+		return false;
+
+	*this = JitterPolicy(minimum, fields == 2 ? maximum : minimum);
+	return isEnabled();
+}
+
+/*! Constructor */
+JitterStatistics::JitterStatistics()
+	: depth(0)
+	, delay(0)
+	, underrunCount(0)
+	, overrunCount(0)
+{
+}
+
+/*! Constructor, the storage for all samples is allocated up front
+	\param policy The range of the playout delay
+	\param channelCount The number of values per sample
+	\param statistics Where the depth, delay and counts are reported
+*/
+JitterBuffer::JitterBuffer(const JitterPolicy &policy, int channelCount, JitterStatistics *statistics)
+	: m_policy(policy)
+	, m_channelCount(channelCount)
+	, m_statistics(statistics)
+	, m_values(CAPACITY * channelCount)
+	, m_timestamps(CAPACITY)
+	, m_head(0)
+	, m_count(0)
+	, m_started(false)
+	, m_meanTransit(0)
+	, m_transitVariance(0)
+	, m_delay(policy.minimumMilliseconds * 1e-3)
+{
+}
+
+/*! Destructor, the samples still held back are no longer counted */
+JitterBuffer::~JitterBuffer()
+{
+	m_statistics->depth.fetch_sub(m_count, std::memory_order_relaxed);
+}
+
+/*! Hold back the sample of channelCount \a values captured at \a timestamp, which arrived at local clock time \a now
+
+	The due samples must have been taken out before.
+	\returns Late if the sample is already due, and Full if the oldest sample has to go first, neither is stored
+*/
+JitterBuffer::Insertion JitterBuffer::insert(const float *values, double timestamp, double now)
+{
+	adapt(now - timestamp);
+
+	if (timestamp + m_delay <= now)
+	{
+		m_statistics->underrunCount.fetch_add(1, std::memory_order_relaxed);
+		return Late;
+	}
+
+	if (m_count == CAPACITY)
+	{
+		m_statistics->overrunCount.fetch_add(1, std::memory_order_relaxed);
+		return Full;
+	}
+
+	// the sample usually goes to the back, a reordered one moves the newer ones up
+	size_t position = m_count;
+	while (position > 0 && m_timestamps[(m_head + position - 1) % CAPACITY] > timestamp)
+	{
+		size_t from = (m_head + position - 1) % CAPACITY;
+		size_t to = (m_head + position) % CAPACITY;
+		m_timestamps[to] = m_timestamps[from];
+		memcpy(&m_values[to * m_channelCount], &m_values[from * m_channelCount], m_channelCount * sizeof(float));
+		position--;
+	}
+
+	size_t slot = (m_head + position) % CAPACITY;
+	m_timestamps[slot] = timestamp;
+	memcpy(&m_values[slot * m_channelCount], values, m_channelCount * sizeof(float));
+	m_count++;
+	m_statistics->depth.fetch_add(1, std::memory_order_relaxed);
+	return Buffered;
+}
+
+/*! \returns true if the oldest sample has reached its playout time at local clock time \a now */
+bool JitterBuffer::isDue(double now) const
+{
+	return m_count > 0 && m_timestamps[m_head] + m_delay <= now;
+}
+
+/*! \returns the values of the oldest sample, the buffer must not be empty */
+const float *JitterBuffer::front() const
+{
+	return &m_values[m_head * m_channelCount];
+}
+
+/*! \returns the timestamp of the oldest sample, the buffer must not be empty */
+double JitterBuffer::frontTimestamp() const
+{
+	return m_timestamps[m_head];
+}
+
+/*! Remove the oldest sample, the buffer must not be empty */
+void JitterBuffer::pop()
+{
+	m_head = (m_head + 1) % CAPACITY;
+	m_count--;
+	m_statistics->depth.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/*! Update the playout delay with the \a transit time of a sample */
+void JitterBuffer::adapt(double transit)
+{
+	if (!m_started)
+	{
+		m_started = true;
+		m_meanTransit = transit;
+		m_transitVariance = 0;
+	}
+	else
+	{
+		double deviation = transit - m_meanTransit;
+		m_meanTransit += TRANSITGAIN * deviation;
+		m_transitVariance += TRANSITGAIN * (deviation * deviation - m_transitVariance);
+	}
+
+	double delay = m_meanTransit + DELAYDEVIATIONS * std::sqrt(m_transitVariance);
+	m_delay = std::min(std::max(delay, m_policy.minimumMilliseconds * 1e-3), m_policy.maximumMilliseconds * 1e-3);
+	m_statistics->delay.store((uint64_t)(m_delay * 1e6), std::memory_order_relaxed);
+}
@@ -0,0 +1,107 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef JITTERBUFFER_H
+#define JITTERBUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*! How long samples are held back before they are pushed, the jitter buffer is disabled by default */
+struct JitterPolicy
+{
+	JitterPolicy(int minimumMilliseconds = 0, int maximumMilliseconds = 0);
+
+	bool isEnabled() const;
+	bool parse(const std::string &setting);
+
+	// the playout delay adapts between these, equal values give a fixed delay
+	int minimumMilliseconds;
+	int maximumMilliseconds;
+};
+
+/*! The statistics of all jitter buffers, safe to read from any thread */
+struct JitterStatistics
+{
+	JitterStatistics();
+
+	// the samples held back by all buffers
+	std::atomic<size_t> depth;
+	// the playout delay last chosen by any buffer, in microseconds
+	std::atomic<uint64_t> delay;
+	// the samples that arrived after their playout time
+	std::atomic<size_t> underrunCount;
+	// the samples that were pushed early because their buffer was full
+	std::atomic<size_t> overrunCount;
+};
+
+/*! Holds back the samples of one outlet until their playout time */
+class JitterBuffer
+{
+public:
+	/*! What happened to an inserted sample */
+	enum Insertion
+	{
+		Buffered,
+		Late,
+		Full
+	};
+
+	JitterBuffer(const JitterPolicy &policy, int channelCount, JitterStatistics *statistics);
+	~JitterBuffer();
+
+	Insertion insert(const float *values, double timestamp, double now);
+
+	bool isEmpty() const { return m_count == 0; }
+	bool isDue(double now) const;
+	const float *front() const;
+	double frontTimestamp() const;
+	void pop();
+
+	double delay() const { return m_delay; }
+
+private:
+	void adapt(double transit);
+
+	JitterPolicy m_policy;
+	int m_channelCount;
+	JitterStatistics *m_statistics;
+
+	// a ring of samples ordered by timestamp
+	std::vector<float> m_values;
+	std::vector<double> m_timestamps;
+	size_t m_head;
+	size_t m_count;
+
+	bool m_started;
+	double m_meanTransit;
+	double m_transitVariance;
+	double m_delay;
+};
+
+#endif
@@ -45,6 +45,7 @@
 /*! Constructor */
 JointAnglesDatagram::JointAnglesDatagram()
 	: Datagram()
+	, m_outlets("JointAnglesDatagram", "jad")
 {
 	setType(SPJointAngles);
 }
@@ -57,59 +58,33 @@ JointAnglesDatagram::~JointAnglesDatagram()
 /*! Deserialize the data from \a arr
 	\sa serializeData
 */
-void JointAnglesDatagram::deserializeData(Streamer &inputStreamer)
+bool JointAnglesDatagram::deserializeData(Streamer &inputStreamer)
 {
-	Streamer* streamer = &inputStreamer;
+	static_assert(Layout::size() == 20, "Layout must match the 20 byte joint layout");
 
-	for (int i = 0; i < dataCount(); i++)
-	{
-		Joint joint;
-
-		// Parent Connection ID  -> 4 byte 
-		streamer->read(joint.parent);
-
-		// Child Connection ID -> 4 byte
-		streamer->read(joint.child);
-
-		// Store the Rotation in a Vector -> 12 byte	(3 x 4 byte)
-		for (int k = 0; k < 3; k++)
-			streamer->read(joint.rotation[k]);
+	// Parent and Child Connection ID and Rotation (3 x 4 byte) are all big endian 32 bit fields
+	return decodeRecords<Layout>(inputStreamer, m_outlets);
+}
 
-		m_data.push_back(joint);
-	}
+/*! \returns the outlets of this datagram type */
+OutletRegistry *JointAnglesDatagram::outlets()
+{
+	return &m_outlets;
 }
 
-lsl::stream_info JointAnglesDatagram::info[2] = {
-	lsl::stream_info("JointAnglesDatagram1", "MoCap", 22 * (5), lsl::IRREGULAR_RATE, lsl::cf_float32, "jad1"),
-	lsl::stream_info("JointAnglesDatagram2", "MoCap", 22 * (5), lsl::IRREGULAR_RATE, lsl::cf_float32, "jad2")
-};
-
-// Create the streams with that stream info
-lsl::stream_outlet JointAnglesDatagram::outlet[2] = {
-	{JointAnglesDatagram::info[0]},
-    {JointAnglesDatagram::info[1]},
-};
-
-std::vector<float> JointAnglesDatagram::alignData() const {
-	std::vector<float> ret;
-	for (auto j : m_data) {
-		ret.push_back(j.parent);
-		ret.push_back(j.child);
-		for (auto r : j.rotation) {
-			ret.push_back(r);
-		}
-	}
-	return ret;
+/*! \returns the decoded records */
+const float *JointAnglesDatagram::sample(size_t &count)
+{
+	return recordSample<Layout>(m_outlets, count);
 }
 
-void JointAnglesDatagram::streamData() const {
-	std::vector<float> ret = alignData();
-	outlet[avatarId()].push_sample(ret);
+void JointAnglesDatagram::streamData() {
+	streamRecords<Layout>(m_outlets);
 }
 
 /*! Print Data datagram in a formated why
 */
-void JointAnglesDatagram::printData() const
+void JointAnglesDatagram::printData()
 {
 	streamData();
 }
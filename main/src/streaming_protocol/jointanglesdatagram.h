@@ -28,30 +28,32 @@
 #define JOINTANGLESDATAGRAM_H
 
 #include "datagram.h"
+#include "outletregistry.h"
+#include "recordlayout.h"
 
 class JointAnglesDatagram : public Datagram {
 
 public:
 	JointAnglesDatagram();
 	virtual ~JointAnglesDatagram();
-	virtual void printData() const override;
+	virtual void printData() override;
+	virtual OutletRegistry *outlets() override;
+	virtual const float *sample(size_t &count) override;
 
 protected:
-	virtual void deserializeData(Streamer &inputStreamer) override;
+	virtual bool deserializeData(Streamer &inputStreamer) override;
 
 private:
-	struct Joint {
-		int32_t parent;	
-		int32_t child;
-		float rotation[3];
-	};
-
-	std::vector<Joint> m_data;
+	/*! One joint on the wire, the connection ids are streamed as channels too */
+	typedef RecordLayout::Record<
+		RecordLayout::Int<2>,		// parent and child connection id
+		RecordLayout::Float<3>		// rotation
+	> Layout;
+
+	// the outlets per avatar, the records are decoded straight into their sample buffers
+	OutletRegistry m_outlets;
 public:
-	std::vector<float> alignData() const;
-	void streamData() const;
-	static lsl::stream_info info[2];
-	static lsl::stream_outlet outlet[2];
+	void streamData();
 };
 
 #endif
@@ -0,0 +1,236 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "latencyhistogram.h"
+#include "datagram.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// the time over which the tick rate is measured against the steady clock
+static const int CALIBRATION_MS = 20;
+
+/*! \class LatencyHistogram
+  \brief Where the time goes, with constant cost per value
+
+  The buckets follow the layout of an HDR histogram. Values below 16 ns have a bucket each, above that every
+  power of two is split into 8 buckets, so a bucket is never wider than 1/8 of its value. 512 buckets reach
+  far beyond any latency the bridge can have, larger values land in the last one.
+
+  There is one writer, so a bucket is incremented with a plain load and store instead of a locked
+  read-modify-write. The count is the sum of the buckets, so recording touches only one of them.
+ */
+
+/*! Constructor */
+LatencyHistogram::LatencyHistogram()
+	: m_max(0)
+{
+	for (std::atomic<uint64_t> &bucket : m_buckets)
+		bucket.store(0, std::memory_order_relaxed);
+}
+
+/*! Count the duration of \a nanoseconds, negative durations count as 0 */
+void LatencyHistogram::record(int64_t nanoseconds)
+{
+	uint64_t value = nanoseconds < 0 ? 0 : (uint64_t)nanoseconds;
+	std::atomic<uint64_t> &counter = m_buckets[bucket(value)];
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	if ((int64_t)value > m_max.load(std::memory_order_relaxed))
+		m_max.store((int64_t)value, std::memory_order_relaxed);
+}
+
+/*! \returns the number of recorded values */
+uint64_t LatencyHistogram::count() const
+{
+	uint64_t total = 0;
+	for (const std::atomic<uint64_t> &bucket : m_buckets)
+		total += bucket.load(std::memory_order_relaxed);
+	return total;
+}
+
+/*! \returns the duration in nanoseconds that \a percent of the values do not exceed, or 0 without values */
+int64_t LatencyHistogram::percentile(double percent) const
+{
+	uint64_t total = count();
+	if (total == 0)
+		return 0;
+
+	uint64_t rank = (uint64_t)(percent / 100.0 * total + 0.5);
+	if (rank < 1)
+		rank = 1;
+
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKETCOUNT; i++)
+	{
+		seen += m_buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank)
+			return std::min(bucketValue(i), max());
+	}
+	return max();
+}
+
+/*! \returns the bucket of \a value */
+int LatencyHistogram::bucket(uint64_t value)
+{
+	if (value < SUBBUCKETS)
+		return (int)value;
+
+#if defined(_MSC_VER)
+	unsigned long highestBit;
+	_BitScanReverse64(&highestBit, value);
+#else
+	int highestBit = 63 - __builtin_clzll(value);
+#endif
+
+	// keep the 4 most significant bits, the highest one is always set
+	int shift = (int)highestBit - 3;
+	int index = SUBBUCKETS + (shift - 1) * (SUBBUCKETS / 2) + (int)((value >> shift) - SUBBUCKETS / 2);
+	return index < BUCKETCOUNT ? index : BUCKETCOUNT - 1;
+}
+
+/*! \returns the highest value that falls in \a bucket */
+int64_t LatencyHistogram::bucketValue(int bucket)
+{
+	if (bucket < SUBBUCKETS)
+		return bucket;
+
+	int shift = (bucket - SUBBUCKETS) / (SUBBUCKETS / 2) + 1;
+	int64_t mantissa = (bucket - SUBBUCKETS) % (SUBBUCKETS / 2) + SUBBUCKETS / 2;
+	return ((mantissa + 1) << shift) - 1;
+}
+
+/*! \class PipelineLatency
+  \brief The latency of every stage of the receive path, per message type
+
+  The processing thread reads the ticks three times per datagram, when it starts on it, after it was parsed
+  and after it was pushed, and records the readings together with the receive timestamp the receive thread
+  put in the ring. The conversions are applied while the records are decoded, so they are part of the parse
+  stage. The histograms of a message type are created with its first datagram.
+
+  On x86 the clock is the time stamp counter, which is read in a few nanoseconds where the steady clock
+  takes tens. Its rate is measured against the steady clock when the latency measurement starts, which is
+  accurate enough for the microseconds of the parse and push stages but not to map ticks to the local clock
+  over hours of uptime. So the queue stage is measured on the local clock that stamps the datagrams, read
+  once when the processing thread starts on a datagram, and the total is the queue plus the ticks after it.
+ */
+
+/*! Constructor, measures the tick rate */
+PipelineLatency::PipelineLatency()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int64_t startTicks = ticks();
+	std::this_thread::sleep_for(std::chrono::milliseconds(CALIBRATION_MS));
+	int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	int64_t elapsedTicks = ticks() - startTicks;
+
+	m_tickNanoseconds = elapsedTicks > 0 ? (double)elapsed / elapsedTicks : 1.0;
+
+	for (std::atomic<StageHistograms*> &type : m_types)
+		type.store(nullptr, std::memory_order_relaxed);
+}
+
+/*! Destructor */
+PipelineLatency::~PipelineLatency()
+{
+	for (std::atomic<StageHistograms*> &type : m_types)
+		delete type.load(std::memory_order_relaxed);
+}
+
+/*! \returns the time stamp counter on x86, and the steady clock time in nanoseconds elsewhere */
+int64_t PipelineLatency::ticks()
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	return (int64_t)__rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/*! Record the stages of a datagram of \a messageType
+
+	\param receiveTime The local clock time the datagram was received
+	\param beginTime The local clock time the processing thread started on the datagram
+	\param begin The ticks() when the processing thread started on the datagram
+	\param parsed The ticks() when the datagram was parsed
+	\param pushed The ticks() when the sample was pushed
+*/
+void PipelineLatency::record(int messageType, double receiveTime, double beginTime, int64_t begin, int64_t parsed, int64_t pushed)
+{
+	std::atomic<StageHistograms*> &type = m_types[messageType & 0xFF];
+	StageHistograms *histograms = type.load(std::memory_order_relaxed);
+	if (!histograms)
+	{
+		histograms = new StageHistograms;
+		type.store(histograms, std::memory_order_release);
+	}
+
+	int64_t queue = (int64_t)((beginTime - receiveTime) * 1e9);
+	(*histograms)[Queue].record(queue);
+	(*histograms)[Parse].record((int64_t)((parsed - begin) * m_tickNanoseconds));
+	(*histograms)[Push].record((int64_t)((pushed - parsed) * m_tickNanoseconds));
+	(*histograms)[Total].record(queue + (int64_t)((pushed - begin) * m_tickNanoseconds));
+}
+
+/*! \returns the histogram of \a stage of datagrams of \a messageType, or nullptr if none was received */
+const LatencyHistogram *PipelineLatency::histogram(int messageType, Stage stage) const
+{
+	const StageHistograms *histograms = m_types[messageType & 0xFF].load(std::memory_order_acquire);
+	return histograms ? &(*histograms)[stage] : nullptr;
+}
+
+/*! Print the p50, p99 and p99.9 of every stage of every message type that was received to \a out */
+void PipelineLatency::print(std::ostream &out) const
+{
+	static const char *STAGENAMES[STAGECOUNT] = { "queue", "parse", "push", "total" };
+
+	for (int messageType = 0; messageType < 256; messageType++)
+	{
+		const StageHistograms *histograms = m_types[messageType].load(std::memory_order_acquire);
+		if (!histograms)
+			continue;
+
+		out << "Latency of " << Datagram::decode(static_cast<StreamingProtocol>(messageType)) << " in us, "
+			<< (*histograms)[Total].count() << " datagrams" << std::endl;
+		for (int stage = 0; stage < STAGECOUNT; stage++)
+		{
+			const LatencyHistogram &histogram = (*histograms)[stage];
+			out << "  " << std::left << std::setw(6) << STAGENAMES[stage] << std::right << std::fixed << std::setprecision(1)
+				<< " p50 " << std::setw(9) << histogram.percentile(50) * 1e-3
+				<< " p99 " << std::setw(9) << histogram.percentile(99) * 1e-3
+				<< " p99.9 " << std::setw(9) << histogram.percentile(99.9) * 1e-3
+				<< " max " << std::setw(9) << histogram.max() * 1e-3 << std::endl;
+		}
+		out << std::defaultfloat;
+	}
+}
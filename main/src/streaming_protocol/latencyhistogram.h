@@ -0,0 +1,93 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+/*! A histogram of durations in nanoseconds with a relative error of at most 1/8
+
+	It is written by a single thread and can be read from any other thread while it is being written.
+*/
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	void record(int64_t nanoseconds);
+
+	uint64_t count() const;
+	int64_t max() const { return m_max.load(std::memory_order_relaxed); }
+	int64_t percentile(double percent) const;
+
+private:
+	// values below this are counted exactly, above it every power of two is split into half as many buckets
+	static const int SUBBUCKETS = 16;
+	static const int BUCKETCOUNT = 512;
+
+	static int bucket(uint64_t value);
+	static int64_t bucketValue(int bucket);
+
+	std::array<std::atomic<uint64_t>, BUCKETCOUNT> m_buckets;
+	std::atomic<int64_t> m_max;
+};
+
+/*! The time datagrams spend in each stage between the socket and their push to LSL, per message type */
+class PipelineLatency
+{
+public:
+	/*! The stages of a datagram */
+	enum Stage
+	{
+		Queue,		// from the receive timestamp until the processing thread picks it up
+		Parse,		// decoding and converting the payload, and timestamping
+		Push,		// handing the sample to the outlet
+		Total,		// from the receive timestamp until the push returned
+		STAGECOUNT
+	};
+
+	PipelineLatency();
+	~PipelineLatency();
+
+	static int64_t ticks();
+
+	void record(int messageType, double receiveTime, double beginTime, int64_t begin, int64_t parsed, int64_t pushed);
+	const LatencyHistogram *histogram(int messageType, Stage stage) const;
+	void print(std::ostream &out) const;
+
+private:
+	typedef std::array<LatencyHistogram, STAGECOUNT> StageHistograms;
+
+	// the duration of a tick
+	double m_tickNanoseconds;
+	std::array<std::atomic<StageHistograms*>, 256> m_types;
+};
+
+#endif
@@ -50,6 +50,7 @@
 /*! Constructor */
 LinearSegmentKinematicsDatagram::LinearSegmentKinematicsDatagram()
 	: Datagram()
+	, m_outlets("LinearSegmentKinematicsDatagram", "lsk")
 {
 	setType(SPLinearSegmentKinematics);
 }
@@ -62,64 +63,34 @@ LinearSegmentKinematicsDatagram::~LinearSegmentKinematicsDatagram()
 /*! Deserialize the data from \a arr
 	\sa serializeData
 */
-void LinearSegmentKinematicsDatagram::deserializeData(Streamer &inputStreamer)
+bool LinearSegmentKinematicsDatagram::deserializeData(Streamer &inputStreamer)
 {
-	Streamer* streamer = &inputStreamer;
+	static_assert(Layout::size() == 40, "Layout must match the 40 byte segment layout");
 
-	for (int i = 0; i < dataCount(); i++)
-	{
-		Kinematics kin;
-
-		// Store the segement Id -> 4 byte 
-		streamer->read(kin.segmentId);
-
-		// Store the Segment Position in a Vector -> 12 byte	(3 x 4 byte)
-		for (int k = 0; k < 3; k++)
-			streamer->read(kin.pos[k]);
-
-		// Store the Segment Velocity in a Vector -> 12 byte	(3 x 4 byte)
-		for (int k = 0; k < 3; k++)
-			streamer->read(kin.velocity[k]);
-
-		// Store the Segmetn Acceleration in a Vector -> 12 byte	(3 x 4 byte)
-		for (int k = 0; k < 3; k++)
-			streamer->read(kin.acceleration[k]);
+	// Segment ID, Position, Velocity and Acceleration (3 x 3 x 4 byte) are all big endian 32 bit fields
+	return decodeRecords<Layout>(inputStreamer, m_outlets);
+}
 
-		m_data.push_back(kin);
-	}
-	
+/*! \returns the outlets of this datagram type */
+OutletRegistry *LinearSegmentKinematicsDatagram::outlets()
+{
+	return &m_outlets;
 }
 
-lsl::stream_info LinearSegmentKinematicsDatagram::info[2] = {
-	lsl::stream_info("LinearSegmentKinematicsDatagram1", "MoCap", 23 * (3 + 3 + 3), lsl::IRREGULAR_RATE, lsl::cf_float32, "lsk1"),
-	lsl::stream_info("LinearSegmentKinematicsDatagram2", "MoCap", 23 * (3 + 3 + 3), lsl::IRREGULAR_RATE, lsl::cf_float32, "lsk2")
-};
-
-// Create the streams with that stream info
-lsl::stream_outlet LinearSegmentKinematicsDatagram::outlet[2] = {
-	{ LinearSegmentKinematicsDatagram::info[0] },
-    { LinearSegmentKinematicsDatagram::info[1] },
-};
-
-std::vector<float> LinearSegmentKinematicsDatagram::alignData() const {
-	std::vector<float> ret;
-	for (auto s : m_data) {
-		for (auto p : s.pos)    	 ret.push_back(p);
-		for (auto v : s.velocity)	 ret.push_back(v);
-		for (auto a : s.acceleration)ret.push_back(a);
-	}
-	return ret;
+/*! \returns the decoded records */
+const float *LinearSegmentKinematicsDatagram::sample(size_t &count)
+{
+	return recordSample<Layout>(m_outlets, count);
 }
 
-void LinearSegmentKinematicsDatagram::streamData() const {
-	std::vector<float> val = alignData();
-	outlet[avatarId()].push_sample(val);
+void LinearSegmentKinematicsDatagram::streamData() {
+	streamRecords<Layout>(m_outlets);
 }
 
 
 /*! Print Data datagram in a formated why
 */
-void LinearSegmentKinematicsDatagram::printData() const
+void LinearSegmentKinematicsDatagram::printData()
 {
 	streamData();
 }
@@ -28,30 +28,33 @@
 #define LINEARSEGMENTKINEMATICSDATAGRAM_H
 
 #include "datagram.h"
+#include "outletregistry.h"
+#include "recordlayout.h"
 
 class LinearSegmentKinematicsDatagram : public Datagram {
 public:
 	LinearSegmentKinematicsDatagram();
 	virtual ~LinearSegmentKinematicsDatagram();
-	virtual void printData() const override;
+	virtual void printData() override;
+	virtual OutletRegistry *outlets() override;
+	virtual const float *sample(size_t &count) override;
 
 protected:
-	virtual void deserializeData (Streamer &inputStreamer) override;
+	virtual bool deserializeData(Streamer &inputStreamer) override;
 
 private:
-	struct Kinematics {
-		int segmentId;
-		float pos[3];
-		float velocity[3];
-		float acceleration[3];
-	};
-
-	std::vector<Kinematics> m_data;
+	/*! One segment on the wire */
+	typedef RecordLayout::Record<
+		RecordLayout::Skip<1>,		// segment id
+		RecordLayout::Float<3>,		// position
+		RecordLayout::Float<3>,		// velocity
+		RecordLayout::Float<3>		// acceleration
+	> Layout;
+
+	// the outlets per avatar, the records are decoded straight into their sample buffers
+	OutletRegistry m_outlets;
 public:
-	std::vector<float> alignData() const;
-	void streamData() const;
-	static lsl::stream_info info[2];
-	static lsl::stream_outlet outlet[2];
+	void streamData();
 };
 
 #endif
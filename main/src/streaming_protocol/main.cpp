@@ -26,18 +26,171 @@
 
 #include "udpserver.h"
 #include "streamer.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
 #include <conio.h>
-#include <xsens/xstime.h>
+#else
+#include <csignal>
+
+static volatile sig_atomic_t g_quit = 0;
+static volatile sig_atomic_t g_printLatency = 0;
+
+static void handleSignal(int)
+{
+	g_quit = 1;
+}
+
+static void handleLatencySignal(int)
+{
+	g_printLatency = 1;
+}
+#endif
+
+/*! Return true when the user asked for the latency percentiles with SIGUSR1, this resets the request */
+static bool latencyRequested()
+{
+#ifdef _WIN32
+	return false;
+#else
+	if (!g_printLatency)
+		return false;
+	g_printLatency = 0;
+	return true;
+#endif
+}
+
+/*! Return true when the user asked to quit: a key press on Windows, SIGINT or SIGTERM elsewhere */
+static bool quitRequested()
+{
+#ifdef _WIN32
+	return _kbhit() != 0;
+#else
+	return g_quit != 0;
+#endif
+}
+
+static void printUsage(const char *program)
+{
+	std::cout << "Usage: " << program << " [--chunk [type=]frames[:milliseconds[:pushthrough]]]..." << std::endl
+		<< "       [--kernel-timestamps] [--aggregate type[,type]...[:milliseconds]] [--drop-late] [--drop-duplicates]" << std::endl
+		<< "       [--jitter-buffer milliseconds[:milliseconds]] [--latency] [--latency-interval seconds]" << std::endl
+		<< "       [--capture file] [--batch-size datagrams]" << std::endl
+		<< "  --chunk              push the samples as chunks of up to <frames> samples, or after <milliseconds>," << std::endl
+		<< "                       for the hexadecimal message <type> (e.g. 02) or for all types; <pushthrough> 0" << std::endl
+		<< "                       lets liblsl hold the chunks until a transfer of <frames> samples is complete" << std::endl
+		<< "  --kernel-timestamps  timestamp the datagrams with the time the kernel received them (Linux only)" << std::endl
+		<< "  --aggregate          also push the message <type>s of a frame as one sample on a combined outlet," << std::endl
+		<< "                       waiting up to <milliseconds> (default 20) for the missing types" << std::endl
+		<< "  --drop-late          do not stream datagrams that arrive after a newer frame of their stream" << std::endl
+		<< "  --drop-duplicates    do not stream datagrams of a frame that was already received" << std::endl
+		<< "  --jitter-buffer      push the samples at the rate they were captured, after a playout delay that" << std::endl
+		<< "                       adapts to the network jitter between the minimum and maximum" << std::endl
+		<< "  --latency            measure the latency of every stage between the socket and LSL and print its" << std::endl
+		<< "                       percentiles on exit, and on SIGUSR1" << std::endl
+		<< "  --latency-interval   also print the latency percentiles every <seconds>" << std::endl
+		<< "  --capture            record every received datagram with its receive time in <file>, with an index" << std::endl
+		<< "                       by time and sample counter" << std::endl
+		<< "  --batch-size         read up to <datagrams> (default 32) from the socket with one system call (Linux)," << std::endl
+		<< "                       more absorbs larger bursts, fewer keeps each batch's parsing delay short" << std::endl;
+}
 
 int main(int argc, char *argv[])
 {
 	std::string hostDestinationAddress = "localhost";
 	int port = 9763;
+	int batchSize = 32;
+	ChunkPolicies chunkPolicies;
+	bool kernelTimestamps = false;
+	AggregationPolicy aggregationPolicy;
+	SequencePolicy sequencePolicy;
+	JitterPolicy jitterPolicy;
+	bool measureLatency = false;
+	int latencyInterval = 0;
+	std::string capturePath;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc && chunkPolicies.parse(argv[i + 1]))
+		{
+			i++;
+			continue;
+		}
+		if (strcmp(argv[i], "--aggregate") == 0 && i + 1 < argc && aggregationPolicy.parse(argv[i + 1]))
+		{
+			i++;
+			continue;
+		}
+		if (strcmp(argv[i], "--jitter-buffer") == 0 && i + 1 < argc && jitterPolicy.parse(argv[i + 1]))
+		{
+			i++;
+			continue;
+		}
+		if (strcmp(argv[i], "--latency") == 0)
+		{
+			measureLatency = true;
+			continue;
+		}
+		if (strcmp(argv[i], "--latency-interval") == 0 && i + 1 < argc && (latencyInterval = atoi(argv[i + 1])) > 0)
+		{
+			measureLatency = true;
+			i++;
+			continue;
+		}
+		if (strcmp(argv[i], "--drop-late") == 0)
+		{
+			sequencePolicy.dropLate = true;
+			continue;
+		}
+		if (strcmp(argv[i], "--drop-duplicates") == 0)
+		{
+			sequencePolicy.dropDuplicates = true;
+			continue;
+		}
+		if (strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc && (batchSize = atoi(argv[i + 1])) > 0)
+		{
+			i++;
+			continue;
+		}
+		if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+		{
+			capturePath = argv[++i];
+			continue;
+		}
+		if (strcmp(argv[i], "--kernel-timestamps") == 0)
+		{
+			kernelTimestamps = true;
+			continue;
+		}
+
+		printUsage(argv[0]);
+		return 1;
+	}
+
+#ifndef _WIN32
+	std::signal(SIGINT, handleSignal);
+	std::signal(SIGTERM, handleSignal);
+	std::signal(SIGUSR1, handleLatencySignal);
+#endif
+
+	UdpServer udpServer(hostDestinationAddress, (uint16_t)port, batchSize, chunkPolicies, kernelTimestamps,
+		aggregationPolicy, sequencePolicy, jitterPolicy, measureLatency, capturePath);
 
-	UdpServer udpServer(hostDestinationAddress, (uint16_t)port);
+	std::chrono::steady_clock::time_point nextReport = std::chrono::steady_clock::now() + std::chrono::seconds(latencyInterval);
+	while (!quitRequested())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
 
-	while (!_kbhit())
-		XsTime::msleep(10);
+		if (latencyRequested() || (latencyInterval > 0 && std::chrono::steady_clock::now() >= nextReport))
+		{
+			udpServer.printLatency();
+			nextReport = std::chrono::steady_clock::now() + std::chrono::seconds(latencyInterval);
+		}
+	}
 
 	return 0;
 }
@@ -74,13 +74,19 @@ bool MetaDatagram::hasItem(const std::string &itemName) const
 
 
 /*! Deserialize the data */
-void MetaDatagram::deserializeData(Streamer &inputStreamer)
+bool MetaDatagram::deserializeData(Streamer &inputStreamer)
 {
 	Streamer* streamer = &inputStreamer;
 
+	if (!streamer->canRead(4))
+		return false;
+
 	int stringSize = 0;
 	streamer->read(stringSize);
 
+	if (stringSize < 0 || !streamer->canRead(stringSize))
+		return false;
+
 	std::string in;
 	streamer->read(in, stringSize);
 
@@ -89,7 +95,7 @@ void MetaDatagram::deserializeData(Streamer &inputStreamer)
 	// split string
 	std::vector<std::string> input = split(in, '\n');
 	
-	for (int i=0; i < input.size(); i++)
+	for (size_t i = 0; i < input.size(); i++)
 	{
 		std::string &item = input.at(i);
 		std::vector<std::string> keyvalue = split(item, ':');
@@ -112,6 +118,12 @@ void MetaDatagram::deserializeData(Streamer &inputStreamer)
 		out.insert(std::pair<std::string,std::string>(key, value));
 	}
 	m_items = out;
+
+	// the outlets of this avatar describe their streams with its name
+	if (avatarInfoTable() && hasItem("name"))
+		avatarInfoTable()->setName(avatarId(), itemData("name"));
+
+	return true;
 }
 
 /*! Return the amount of items in this datagram
@@ -127,7 +139,7 @@ int MetaDatagram::itemCount() const
 
 /*! Print Data datagram in a formated why
 */
-void MetaDatagram::printData() const
+void MetaDatagram::printData()
 {
 	std::cout << "*********************** DATA CONTENT ***********************" <<  std::endl <<  std::endl;
 	if (itemCount()) 
@@ -164,7 +176,7 @@ std::vector<std::string> MetaDatagram::split(std::string str, char delimiter) {
 
 
 // Joins all the string list's strings into a single string with each element separated by the given separator
-std::string MetaDatagram::join(std::vector<std::string> strList, char* delimiter) {
+std::string MetaDatagram::join(std::vector<std::string> strList, const char* delimiter) {
 
 	std::string res;
 	for (int i = 0; strList.size(); i++) 
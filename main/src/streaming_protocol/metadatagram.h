@@ -28,21 +28,22 @@
 #define METADATAGRAM_H
 
 #include "datagram.h"
+#include <map>
 
 class MetaDatagram : public Datagram {
 public:
 	MetaDatagram();
 	virtual ~MetaDatagram();
 
-	virtual void printData() const override;
+	virtual void printData() override;
 
 protected:
-	virtual void deserializeData(Streamer &inputStreamer) override;
+	virtual bool deserializeData(Streamer &inputStreamer) override;
 
 private:
 	std::map<std::string, std::string> m_items;
 	std::vector<std::string> split(std::string str, char delimiter);
-	std::string MetaDatagram::join(std::vector<std::string> strList, char* delimiter);
+	std::string join(std::vector<std::string> strList, const char* delimiter);
 
 	std::string itemData(const std::string &itemName) const;
 	bool hasItem(const std::string &itemName) const;
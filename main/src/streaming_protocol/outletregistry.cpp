@@ -0,0 +1,293 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "outletregistry.h"
+
+/*! \class OutletRegistry
+  \brief The LSL outlets of one datagram type, one per avatar
+
+  An outlet is created when the first packet of an avatar arrives, so only streams that actually
+  carry data are advertised on the network. Its channel count follows from the number of records in
+  that packet, and the outlet is re-created when a packet arrives with a different number of records
+  or the avatar's name or segment names change, so consumers always get exactly one channel per value. The outlets are stored in a table indexed by the avatar id,
+  finding one is a single lookup without locking. The registry belongs to the datagram that parses
+  its type and is only used from the processing thread.
+
+  The stream of avatar N (counting from 1) is named <name>N and has the source id <sourceId>N.
+ */
+
+/*! Create the outlet described by \a info, with its sample and chunk buffers preallocated
+	\param avatarRevision the revision of the AvatarInfo the description was built from
+	\param policy when the samples are pushed, liblsl also uses its frame count as the transfer chunk size
+	\param jitterPolicy how long the samples are held back before they are pushed
+	\param jitterStatistics where the jitter buffer reports, required if \a jitterPolicy is enabled
+	\param publish false creates the buffers only, the samples are decoded but not sent
+*/
+OutletRegistry::Outlet::Outlet(const lsl::stream_info &info, unsigned int avatarRevision, const ChunkPolicy &policy,
+	const JitterPolicy &jitterPolicy, JitterStatistics *jitterStatistics, bool publish)
+	: outlet(publish ? new lsl::stream_outlet(info, policy.isImmediate() ? 0 : policy.frames) : nullptr)
+	, channelCount(info.channel_count())
+	, avatarRevision(avatarRevision)
+	, policy(policy)
+{
+	if (jitterPolicy.isEnabled() && jitterStatistics)
+		jitter.reset(new JitterBuffer(jitterPolicy, channelCount, jitterStatistics));
+
+	sample.reserve(channelCount);
+	if (!policy.isImmediate())
+	{
+		chunk.reserve(channelCount * policy.frames);
+		timestamps.reserve(policy.frames);
+	}
+}
+
+/*! Destructor, pushes the samples that are still pending or held back */
+OutletRegistry::Outlet::~Outlet()
+{
+	while (jitter && !jitter->isEmpty())
+	{
+		send(jitter->front(), jitter->frontTimestamp());
+		jitter->pop();
+	}
+	flush();
+}
+
+/*! Push the sample of channelCount \a values taken at \a timestamp
+
+	With a jitter buffer the sample is held back until its playout time, otherwise it is sent right away.
+*/
+void OutletRegistry::Outlet::push(const float *values, double timestamp)
+{
+	if (!jitter)
+	{
+		send(values, timestamp);
+		return;
+	}
+
+	double now = lsl::local_clock();
+	playout(now);
+
+	JitterBuffer::Insertion insertion = jitter->insert(values, timestamp, now);
+	if (insertion == JitterBuffer::Full)
+	{
+		send(jitter->front(), jitter->frontTimestamp());
+		jitter->pop();
+		insertion = jitter->insert(values, timestamp, now);
+	}
+	if (insertion != JitterBuffer::Buffered)
+		send(values, timestamp);
+}
+
+/*! Send the samples of the jitter buffer that reached their playout time at local clock time \a now */
+void OutletRegistry::Outlet::playout(double now)
+{
+	while (jitter && jitter->isDue(now))
+	{
+		send(jitter->front(), jitter->frontTimestamp());
+		jitter->pop();
+	}
+}
+
+/*! Push the sample of channelCount \a values taken at \a timestamp, or queue it for the next chunk */
+void OutletRegistry::Outlet::send(const float *values, double timestamp)
+{
+	if (!outlet)
+		return;
+
+	if (policy.isImmediate())
+	{
+		outlet->push_sample(values, timestamp, policy.pushthrough);
+		return;
+	}
+
+	chunk.insert(chunk.end(), values, values + channelCount);
+	timestamps.push_back(timestamp);
+
+	if (timestamps.size() >= static_cast<size_t>(policy.frames) || isExpired(timestamp))
+		flush();
+}
+
+/*! Push all pending samples as one chunk */
+void OutletRegistry::Outlet::flush()
+{
+	if (timestamps.empty())
+		return;
+
+	outlet->push_chunk_multiplexed(chunk, timestamps, policy.pushthrough);
+	chunk.clear();
+	timestamps.clear();
+}
+
+/*! \returns true if the oldest pending sample has waited for the time limit of the policy at time \a now */
+bool OutletRegistry::Outlet::isExpired(double now) const
+{
+	return policy.milliseconds > 0 && !timestamps.empty()
+		&& (now - timestamps.front()) * 1000.0 >= policy.milliseconds;
+}
+
+/*! Constructor
+	\param name the stream name, the avatar number is appended
+	\param sourceId the source id, the avatar number is appended
+	\param format the channel format of each stream
+*/
+OutletRegistry::OutletRegistry(const std::string &name, const std::string &sourceId,
+	lsl::channel_format_t format)
+	: m_name(name)
+	, m_sourceId(sourceId)
+	, m_format(format)
+	, m_jitterStatistics(nullptr)
+	, m_publishing(true)
+	, m_outletCount(0)
+	, m_recreatedCount(0)
+{
+}
+
+/*! Destructor */
+OutletRegistry::~OutletRegistry()
+{
+}
+
+/*! Return the outlet of avatar \a avatarId for samples of \a recordCount records of \a recordChannels channels each
+
+	The outlet is created on first use and re-created when the channel count or the revision of \a avatar
+	differs from the ones it was created with.
+*/
+OutletRegistry::Outlet &OutletRegistry::outlet(uint8_t avatarId, int recordCount, int recordChannels, const AvatarInfo *avatar)
+{
+	std::unique_ptr<Outlet> &entry = m_outlets[avatarId];
+	unsigned int revision = avatar ? avatar->revision : 0;
+
+	if (entry && entry->channelCount == recordCount * recordChannels && entry->avatarRevision == revision)
+		return *entry;
+
+	if (entry)
+	{
+		// close the old stream first, so the new one does not coexist with it under the same source id
+		entry.reset();
+		m_recreatedCount++;
+	}
+	else
+	{
+		m_outletCount++;
+		m_avatarIds.push_back(avatarId);
+	}
+
+	entry.reset(new Outlet(streamInfo(avatarId, recordCount, recordChannels, avatar), revision, m_policy,
+		m_jitterPolicy, m_jitterStatistics, m_publishing));
+	if (m_publishing)
+		std::cout << "Streaming " << m_name << avatarId + 1 << " with " << entry->channelCount << " channels" << std::endl;
+
+	return *entry;
+}
+
+/*! \returns the number of avatars that have an outlet */
+size_t OutletRegistry::outletCount() const
+{
+	return m_outletCount;
+}
+
+/*! \returns how often an outlet was re-created because its layout changed */
+size_t OutletRegistry::recreatedCount() const
+{
+	return m_recreatedCount;
+}
+
+/*! Use \a policy for the outlets that are created from now on */
+void OutletRegistry::setChunkPolicy(const ChunkPolicy &policy)
+{
+	m_policy = policy;
+}
+
+/*! Hold the samples of the outlets that are created from now on back according to \a policy
+
+	The jitter buffers report to \a statistics, which must outlive the registry.
+*/
+void OutletRegistry::setJitterPolicy(const JitterPolicy &policy, JitterStatistics *statistics)
+{
+	m_jitterPolicy = policy;
+	m_jitterStatistics = statistics;
+}
+
+/*! Create the outlets from now on with a stream on the network if \a publishing is true, the default
+
+	Without publishing the outlets only provide the buffers the samples are decoded into, which lets the
+	parsers run without advertising streams.
+*/
+void OutletRegistry::setPublishing(bool publishing)
+{
+	m_publishing = publishing;
+}
+
+/*! Push the samples that reached their playout time and the chunks whose oldest sample has waited for the
+	time limit at time \a now
+
+	This lets samples go out when the packets of their stream stop arriving.
+*/
+void OutletRegistry::flushExpired(double now)
+{
+	if (!m_jitterPolicy.isEnabled() && (m_policy.isImmediate() || m_policy.milliseconds == 0))
+		return;
+
+	for (uint8_t avatarId : m_avatarIds)
+	{
+		Outlet &entry = *m_outlets[avatarId];
+		entry.playout(now);
+		if (entry.isExpired(now))
+			entry.flush();
+	}
+}
+
+/*! Describe the stream of avatar \a avatarId
+
+	The description lists the number of records and channels per record, and the avatar name and segment
+	names when the meta and scale datagrams provided them.
+*/
+lsl::stream_info OutletRegistry::streamInfo(uint8_t avatarId, int recordCount, int recordChannels, const AvatarInfo *avatar) const
+{
+	std::string number = std::to_string(avatarId + 1);
+	lsl::stream_info info(m_name + number, "MoCap", recordCount * recordChannels,
+		lsl::IRREGULAR_RATE, m_format, m_sourceId + number);
+
+	lsl::xml_element desc = info.desc();
+	desc.append_child_value("records", std::to_string(recordCount));
+	desc.append_child_value("channels_per_record", std::to_string(recordChannels));
+
+	if (avatar)
+	{
+		if (!avatar->name.empty())
+			desc.append_child_value("avatar", avatar->name);
+
+		// the segment names only apply when there is one record per segment
+		if (avatar->segmentNames.size() == static_cast<size_t>(recordCount))
+		{
+			lsl::xml_element segments = desc.append_child("segments");
+			for (const std::string &segmentName : avatar->segmentNames)
+				segments.append_child_value("segment", segmentName);
+		}
+	}
+
+	return info;
+}
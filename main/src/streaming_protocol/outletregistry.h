@@ -0,0 +1,106 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OUTLETREGISTRY_H
+#define OUTLETREGISTRY_H
+
+#include <array>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lsl_cpp.h"
+#include "avatarinfo.h"
+#include "chunkpolicy.h"
+#include "jitterbuffer.h"
+
+class OutletRegistry
+{
+public:
+	/*! The outlet of one avatar together with the buffer its samples are decoded into */
+	struct Outlet
+	{
+		Outlet(const lsl::stream_info &info, unsigned int avatarRevision, const ChunkPolicy &policy,
+			const JitterPolicy &jitterPolicy = JitterPolicy(), JitterStatistics *jitterStatistics = nullptr,
+			bool publish = true);
+		~Outlet();
+
+		void push(const float *values, double timestamp);
+		void send(const float *values, double timestamp);
+		void playout(double now);
+		void flush();
+		bool isExpired(double now) const;
+
+		// nullptr if the registry does not publish its streams
+		std::unique_ptr<lsl::stream_outlet> outlet;
+		std::vector<float> sample;
+		int channelCount;
+		unsigned int avatarRevision;
+
+		// the samples waiting to be pushed as one chunk, and their timestamps
+		ChunkPolicy policy;
+		std::vector<float> chunk;
+		std::vector<double> timestamps;
+
+		// the samples held back until their playout time, if the jitter buffer is enabled
+		std::unique_ptr<JitterBuffer> jitter;
+	};
+
+	OutletRegistry(const std::string &name, const std::string &sourceId,
+		lsl::channel_format_t format = lsl::cf_float32);
+	~OutletRegistry();
+
+	Outlet &outlet(uint8_t avatarId, int recordCount, int recordChannels, const AvatarInfo *avatar = nullptr);
+	size_t outletCount() const;
+	size_t recreatedCount() const;
+
+	void setChunkPolicy(const ChunkPolicy &policy);
+	void setJitterPolicy(const JitterPolicy &policy, JitterStatistics *statistics);
+	void setPublishing(bool publishing);
+	void flushExpired(double now);
+
+private:
+	lsl::stream_info streamInfo(uint8_t avatarId, int recordCount, int recordChannels, const AvatarInfo *avatar) const;
+
+	std::string m_name;
+	std::string m_sourceId;
+	lsl::channel_format_t m_format;
+	ChunkPolicy m_policy;
+	JitterPolicy m_jitterPolicy;
+	JitterStatistics *m_jitterStatistics;
+	bool m_publishing;
+
+	// the avatar id is a single byte on the wire, so every possible avatar has a slot
+	std::array<std::unique_ptr<Outlet>, 256> m_outlets;
+	size_t m_outletCount;
+	size_t m_recreatedCount;
+
+	// the avatars that have an outlet, so pending chunks can be found without scanning the table
+	std::vector<uint8_t> m_avatarIds;
+};
+
+#endif
@@ -0,0 +1,81 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "packetring.h"
+
+/*! \class PacketRing
+	\brief A fixed capacity, lock-free single producer / single consumer ring of datagram slots
+
+	All memory is allocated once at construction. The socket writes received datagrams straight
+	into the free slots and the parser reads them in place, so the receive path does not allocate
+	per packet.
+
+	The producer fills free slots with writeSlot(), setSize() and setTimestamp() and publishes them with push().
+	The consumer reads the published slots with readSlot(), readSize() and readTimestamp() and releases
+	them with pop(). The timestamp is the local time the datagram was received at.
+	Exactly one thread may act as producer and one thread as consumer.
+
+	The ring keeps track of the highest number of slots that were ever in use and of the
+	datagrams the producer had to drop because the ring was full.
+*/
+
+/*! Construct a ring of \a slotCount slots of \a slotSize bytes each
+
+	\a slotCount is rounded up to a power of two so slot indices can be wrapped with a mask.
+	Datagrams larger than \a slotSize do not fit in a slot.
+*/
+PacketRing::PacketRing(size_t slotCount, size_t slotSize)
+	: m_slotCount(1)
+	, m_slotSize(slotSize)
+	, m_head(0)
+	, m_highWaterMark(0)
+	, m_overflowCount(0)
+	, m_tail(0)
+{
+	while (m_slotCount < slotCount)
+		m_slotCount <<= 1;
+	m_mask = m_slotCount - 1;
+
+	m_buffer.resize(m_slotCount * m_slotSize);
+	m_sizes.resize(m_slotCount);
+	m_timestamps.resize(m_slotCount);
+}
+
+/*! Destructor */
+PacketRing::~PacketRing()
+{
+}
+
+/*! Publish the next \a count slots to the consumer */
+void PacketRing::push(size_t count)
+{
+	size_t head = m_head.load(std::memory_order_relaxed) + count;
+	m_head.store(head, std::memory_order_release);
+
+	size_t used = head - m_tail.load(std::memory_order_acquire);
+	if (used > m_highWaterMark.load(std::memory_order_relaxed))
+		m_highWaterMark.store(used, std::memory_order_relaxed);
+}
@@ -0,0 +1,86 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef PACKETRING_H
+#define PACKETRING_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+class PacketRing
+{
+public:
+	PacketRing(size_t slotCount = 1024, size_t slotSize = 2048);
+	~PacketRing();
+
+	size_t capacity() const { return m_slotCount; }
+	size_t slotSize() const { return m_slotSize; }
+
+	// producer side
+	size_t freeSlots() const { return m_slotCount - (m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire)); }
+	uint8_t* writeSlot(size_t offset) { return slotData(m_head.load(std::memory_order_relaxed) + offset); }
+	void setSize(size_t offset, size_t size) { m_sizes[(m_head.load(std::memory_order_relaxed) + offset) & m_mask] = size; }
+	void setTimestamp(size_t offset, double timestamp) { m_timestamps[(m_head.load(std::memory_order_relaxed) + offset) & m_mask] = timestamp; }
+	void push(size_t count);
+	void drop(size_t count = 1) { m_overflowCount.fetch_add(count, std::memory_order_relaxed); }
+
+	// consumer side
+	size_t usedSlots() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_relaxed); }
+	const uint8_t* readSlot(size_t offset) const { return slotData(m_tail.load(std::memory_order_relaxed) + offset); }
+	size_t readSize(size_t offset) const { return m_sizes[(m_tail.load(std::memory_order_relaxed) + offset) & m_mask]; }
+	double readTimestamp(size_t offset) const { return m_timestamps[(m_tail.load(std::memory_order_relaxed) + offset) & m_mask]; }
+	void pop(size_t count) { m_tail.store(m_tail.load(std::memory_order_relaxed) + count, std::memory_order_release); }
+
+	// statistics, safe to read from any thread
+	size_t highWaterMark() const { return m_highWaterMark.load(std::memory_order_relaxed); }
+	size_t overflowCount() const { return m_overflowCount.load(std::memory_order_relaxed); }
+
+private:
+	uint8_t* slotData(size_t index) { return &m_buffer[(index & m_mask) * m_slotSize]; }
+	const uint8_t* slotData(size_t index) const { return &m_buffer[(index & m_mask) * m_slotSize]; }
+
+	size_t m_slotCount;
+	size_t m_slotSize;
+	size_t m_mask;
+
+	// the producer and consumer indices live on separate cache lines to avoid false sharing. They are kept
+	// apart by padding rather than alignas, as C++11 operator new ignores extended alignment.
+	static const size_t CACHELINESIZE = 64;
+
+	std::atomic<size_t> m_head;
+	std::atomic<size_t> m_highWaterMark;
+	std::atomic<size_t> m_overflowCount;
+	char m_padding[CACHELINESIZE - 3 * sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> m_tail;
+
+	std::vector<uint8_t> m_buffer;
+	std::vector<size_t> m_sizes;
+	std::vector<double> m_timestamps;
+};
+
+#endif
@@ -25,6 +25,7 @@
 */
 
 #include "parsermanager.h"
+#include "datagramheader.h"
 
 #include "eulerdatagram.h"
 #include "scaledatagram.h"
@@ -37,9 +38,27 @@
 #include "positiondatagram.h"
 #include "timecodedatagram.h"
 #include "trackerkinematicsdatagram.h"
+#include "outletregistry.h"
 
-ParserManager::ParserManager()
+/*! Constructor
+	\param chunkPolicies how the samples of each message type are pushed to LSL
+	\param aggregationPolicy which message types are also pushed as one combined sample per frame
+	\param sequencePolicy which out of sequence datagrams are dropped
+	\param jitterPolicy how long the samples of all outlets are held back before they are pushed
+	\param measureLatency record the latency of every stage of every datagram, see PipelineLatency
+*/
+ParserManager::ParserManager(const ChunkPolicies &chunkPolicies, const AggregationPolicy &aggregationPolicy,
+	const SequencePolicy &sequencePolicy, const JitterPolicy &jitterPolicy, bool measureLatency)
+	: m_chunkPolicies(chunkPolicies)
+	, m_jitterPolicy(jitterPolicy)
+	, m_malformedCount(0)
+	, m_frameAggregator(aggregationPolicy, &m_avatars)
+	, m_sequenceTracker(sequencePolicy)
+	, m_latency(measureLatency ? new PipelineLatency : nullptr)
 { 
+	OutletRegistry *outlets = m_frameAggregator.outlets();
+	outlets->setJitterPolicy(m_jitterPolicy, &m_jitterStatistics);
+	m_outletRegistries.push_back(outlets);
 }
 
 /*! Destructor */
@@ -68,18 +87,172 @@ Datagram* ParserManager::createDgram(StreamingProtocol proto)
 	}	
 }
 
-/*! Read single datagram from the incoming stream */
-void ParserManager::readDatagram(const XsByteArray &data)
+/*! Return the datagram that parses messages of \a type
+
+	There is one instance per message type, it is created on first use and reused for every following
+	packet of that type, so parsing does not allocate a datagram per packet.
+	\returns nullptr if the message type is not supported
+*/
+Datagram* ParserManager::datagram(int type)
+{
+	if (type < 0)
+		return nullptr;
+
+	std::unique_ptr<Datagram> &dgram = m_datagrams[type & 0xFF];
+	if (!dgram)
+	{
+		dgram.reset(createDgram(static_cast<StreamingProtocol>(type)));
+		if (dgram)
+		{
+			dgram->setAvatarInfo(&m_avatars);
+
+			OutletRegistry *outlets = dgram->outlets();
+			if (outlets)
+			{
+				outlets->setChunkPolicy(m_chunkPolicies.policy(type));
+				outlets->setJitterPolicy(m_jitterPolicy, &m_jitterStatistics);
+				m_outletRegistries.push_back(outlets);
+			}
+		}
+	}
+
+	return dgram.get();
+}
+
+/*! Read single datagram of \a size bytes at \a data that was received at local clock time \a receiveTime
+
+	Datagrams with an invalid header or a truncated payload are counted and dropped. The parts of a split frame
+	are held back until the FrameReassembler has all of them, and are then read as one datagram that was
+	received with its first part. The sample counters of the streamed datagrams are followed by the
+	SequenceTracker, which may drop late and duplicate ones. Streamed datagrams are stamped with the capture
+	time that the SenderClock of their avatar maps their frame time to.
+*/
+void ParserManager::readDatagram(const uint8_t* data, size_t size, double receiveTime)
 {
-	StreamingProtocol type = static_cast<StreamingProtocol>(Datagram::messageType(data));
-	Datagram *datagram = createDgram(type);
+	double beginTime = m_latency ? lsl::local_clock() : 0.0;
+	int64_t begin = m_latency ? PipelineLatency::ticks() : 0;
 
-	if (datagram != nullptr) 
+	DatagramHeader header(data, size);
+	if (!header.isValid())
 	{
-		datagram->deserialize(data);
+		m_malformedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Datagram *dgram = datagram(header.messageType());
+	if (dgram == nullptr)
+		return;
+
+	if (FrameReassembler::isSplit(header))
+	{
+		if (!m_frameReassembler.add(header, receiveTime))
+			return;
+
+		data = m_frameReassembler.frame();
+		size = m_frameReassembler.frameSize();
+		receiveTime = m_frameReassembler.frameReceiveTime();
+	}
+
+	if (!dgram->deserialize(data, size))
+	{
+		m_malformedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	if (dgram->outlets()
+		&& m_sequenceTracker.isDropped(m_sequenceTracker.track(dgram->avatarId(), header.messageType(), dgram->sampleCounter())))
+		return;
+
+	if (dgram->outlets())
+		dgram->setTimestamp(m_senderClocks[dgram->avatarId()].timestamp(dgram->frameTime(), receiveTime));
+	else
+		dgram->setTimestamp(receiveTime);
+
+	int64_t parsed = m_latency ? PipelineLatency::ticks() : 0;
+
+	dgram->printHeader();
+	dgram->printData();
+
+	if (m_frameAggregator.isAggregated(header.messageType()))
+	{
+		size_t count = 0;
+		const float *values = dgram->sample(count);
+		if (values)
+			m_frameAggregator.add(dgram->avatarId(), header.messageType(), dgram->sampleCounter(), values, count,
+				dgram->timestamp(), receiveTime);
+	}
+
+	if (m_latency)
+		m_latency->record(header.messageType(), receiveTime, beginTime, begin, parsed, PipelineLatency::ticks());
+}
+
+/*! Read all datagrams pending in \a ring in place and release their slots
 
-		datagram->printHeader();
-		datagram->printData();
+	Empty slots hold datagrams that were dropped by the receiver and are skipped.
+*/
+void ParserManager::readDatagrams(PacketRing &ring)
+{
+	size_t count = ring.usedSlots();
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t size = ring.readSize(i);
+		if (size > 0)
+			readDatagram(ring.readSlot(i), size, ring.readTimestamp(i));
 	}
-	delete datagram;
+	ring.pop(count);
+}
+
+/*! Push the pending chunks that have waited for the time limit of their policy at time \a now
+
+	This also pushes the samples that reached the playout time of the jitter buffer, drops the split frames
+	that did not complete in time, and pushes the combined frames that stopped waiting for their missing types.
+*/
+void ParserManager::flushExpired(double now)
+{
+	m_frameReassembler.expire(now);
+	m_frameAggregator.expire(now);
+	for (OutletRegistry *outlets : m_outletRegistries)
+		outlets->flushExpired(now);
+}
+
+/*! \returns the clock model of avatar \a avatarId, it is only updated from the processing thread */
+const SenderClock &ParserManager::senderClock(uint8_t avatarId) const
+{
+	return m_senderClocks[avatarId];
+}
+
+/*! \returns the reassembly of split frames, its statistics are safe to read from any thread */
+const FrameReassembler &ParserManager::frameReassembler() const
+{
+	return m_frameReassembler;
+}
+
+/*! \returns the combining of message types per frame, its statistics are safe to read from any thread */
+const FrameAggregator &ParserManager::frameAggregator() const
+{
+	return m_frameAggregator;
+}
+
+/*! \returns the sample counter statistics of the streamed datagrams, they are safe to read from any thread */
+const SequenceTracker &ParserManager::sequenceTracker() const
+{
+	return m_sequenceTracker;
+}
+
+/*! \returns the state of the jitter buffers of all outlets, it is safe to read from any thread */
+const JitterStatistics &ParserManager::jitterStatistics() const
+{
+	return m_jitterStatistics;
+}
+
+/*! \returns the stage latencies, which are safe to read from any thread, or nullptr if they are not measured */
+const PipelineLatency *ParserManager::latency() const
+{
+	return m_latency.get();
+}
+
+/*! \returns the number of datagrams that were dropped because they were malformed or truncated */
+size_t ParserManager::malformedCount() const
+{
+	return m_malformedCount.load(std::memory_order_relaxed);
 }
@@ -28,16 +28,52 @@
 #define PARSERMANAGER_H
 
 #include "datagram.h"
+#include "packetring.h"
+#include "chunkpolicy.h"
+#include "senderclock.h"
+#include "framereassembler.h"
+#include "frameaggregator.h"
+#include "sequencetracker.h"
+#include "latencyhistogram.h"
+#include <atomic>
 
 class ParserManager
 {
 public:
-	ParserManager();
+	ParserManager(const ChunkPolicies &chunkPolicies = ChunkPolicies(),
+		const AggregationPolicy &aggregationPolicy = AggregationPolicy(),
+		const SequencePolicy &sequencePolicy = SequencePolicy(),
+		const JitterPolicy &jitterPolicy = JitterPolicy(), bool measureLatency = false);
 	~ParserManager();
-	void readDatagram(const XsByteArray &data);
+	void readDatagram(const uint8_t* data, size_t size, double receiveTime);
+	void readDatagrams(PacketRing &ring);
+
+	size_t malformedCount() const;
+	const FrameReassembler &frameReassembler() const;
+	const FrameAggregator &frameAggregator() const;
+	const SequenceTracker &sequenceTracker() const;
+	const JitterStatistics &jitterStatistics() const;
+	const PipelineLatency *latency() const;
+
+	void flushExpired(double now);
+	const SenderClock &senderClock(uint8_t avatarId) const;
 
 private:
 	Datagram* createDgram(StreamingProtocol proto);
+	Datagram* datagram(int type);
+
+	AvatarInfoTable m_avatars;
+	std::array<SenderClock, 256> m_senderClocks;
+	ChunkPolicies m_chunkPolicies;
+	JitterPolicy m_jitterPolicy;
+	JitterStatistics m_jitterStatistics;
+	std::vector<OutletRegistry*> m_outletRegistries;
+	std::array<std::unique_ptr<Datagram>, 256> m_datagrams;
+	std::atomic<size_t> m_malformedCount;
+	FrameReassembler m_frameReassembler;
+	FrameAggregator m_frameAggregator;
+	SequenceTracker m_sequenceTracker;
+	std::unique_ptr<PipelineLatency> m_latency;
 };
 
 #endif
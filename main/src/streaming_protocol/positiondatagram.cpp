@@ -57,59 +57,23 @@ PositionDatagram::~PositionDatagram()
 /*! Deserialize the data from \a arr
 	\sa serializeData
 */
-void PositionDatagram::deserializeData(Streamer &inputStreamer)
+bool PositionDatagram::deserializeData(Streamer &inputStreamer)
 {
-	Streamer* streamer = &inputStreamer;
+	static_assert(Layout::size() == 16, "Layout must match the 16 byte point layout");
 
-	for (int i = 0; i < dataCount(); i++)
-	{
-		VirtualMarkerSet marker;
-
-		// Store the segement Id -> 4 byte
-		streamer->read(marker.segmentId);
-
-		// Store the Point Position in a Vector -> 12 byte	(3 x 4 byte)
-		// The coordinates use a Y-Up, right-handed coordinate system.
-		for (int k = 0; k < 3; k++)
-			streamer->read(marker.pointPos[k]);
-
-		for (int k = 0; k < 3; k++)
-			marker.pointPos[k] /= EULERPOSITIONSCALE;
-
-		convertFromYupToZup(marker.pointPos);
-
-		m_data.push_back(marker);
-	}
+	// Point ID and Point Position (3 x 4 byte) are all big endian 32 bit fields
+	// The coordinates use a Y-Up, right-handed coordinate system.
+	return decodeRecords<Layout>(inputStreamer, m_sample);
 }
 
 
-lsl::stream_info PositionDatagram::info[2] = {
-	lsl::stream_info("PositionDatagram1", "MoCap", 23 * (3), lsl::IRREGULAR_RATE, lsl::cf_float32, "pd1"),
-	lsl::stream_info("PositionDatagram2", "MoCap", 23 * (3), lsl::IRREGULAR_RATE, lsl::cf_float32, "pd2")
-};
-
-// Create the streams with that stream info
-lsl::stream_outlet PositionDatagram::outlet[2] = {
-	{ PositionDatagram::info[0] },
-    { PositionDatagram::info[1] },
-};
-
-std::vector<float> PositionDatagram::alignData() const {
-	std::vector<float> ret;
-
-	for (auto s : m_data) {
-		for (auto p : s.pointPos) ret.push_back(p);
-	}
-	return ret;
-}
-
-void PositionDatagram::streamData() const {
+void PositionDatagram::streamData() {
 
 }
 
 /*! Print Data datagram in a formated why
 */
-void PositionDatagram::printData() const
+void PositionDatagram::printData()
 {
 	streamData();
 }
@@ -28,28 +28,28 @@
 #define POSITIONDATAGRAM_H
 
 #include "datagram.h"
+#include "recordlayout.h"
 
 class PositionDatagram : public Datagram {
 public:
 	PositionDatagram();
 	virtual ~PositionDatagram();
-	virtual void printData() const override;
+	virtual void printData() override;
 
 protected:
-	virtual void deserializeData(Streamer &inputStreamer) override;
+	virtual bool deserializeData(Streamer &inputStreamer) override;
 
 private:
-	struct VirtualMarkerSet {
-		int segmentId;	
-		float pointPos[3];
-	};
-
-	std::vector<VirtualMarkerSet> m_data;
+	/*! One point on the wire, the position is scaled to meters and converted to Z-Up */
+	typedef RecordLayout::Record<
+		RecordLayout::Skip<1>,		// point id
+		RecordLayout::Float<3, RecordLayout::Chain<PositionScale, YupToZup>>		// position
+	> Layout;
+
+	// the decoded points, they are not streamed
+	std::vector<float> m_sample;
 public:
-	std::vector<float> alignData() const;
-	void streamData() const;
-	static lsl::stream_info info[2];
-	static lsl::stream_outlet outlet[2];
+	void streamData();
 };
 
 #endif
@@ -25,7 +25,6 @@
 */
 
 #include "quaterniondatagram.h"
-#include <xsens/xsmath.h>
 
 /*! \class QuaternionDatagram
   \brief a Position & Quaternion orientation pose datagram (type 02)
@@ -49,6 +48,7 @@
 /*! Constructor */
 QuaternionDatagram::QuaternionDatagram()
 	: Datagram()
+	, m_outlets("QuaternionDatagram", "qd")
 {
 	setType(SPPoseQuaternion);
 }
@@ -62,61 +62,32 @@ QuaternionDatagram::~QuaternionDatagram()
 /*! Deserialize the data from \a arr
 	\sa serializeData
 */
-void QuaternionDatagram::deserializeData(Streamer &inputStreamer)
+bool QuaternionDatagram::deserializeData(Streamer &inputStreamer)
 {
-	Streamer* streamer = &inputStreamer;
+	static_assert(Layout::size() == 32, "Layout must match the 32 byte segment layout");
 
-	for (int i = 0; i < dataCount(); i++)
-	{
-		Kinematics kin;
-
-		// 4 byte
-		streamer->read(kin.segmentId);
-
-		// Store the Sensor Position in a Vector -> 12 byte	(3 x 4 byte)
-		// The coordinates use a Z-Up, right-handed coordinate system.
-		for (int k = 0; k < 3; k++)
-			streamer->read(kin.sensorPos[k]);
-
-		// Store the Quaternion Rotation in a vector -> 16 byte	(4 x 4 byte) 
-		for (int k = 0; k < 4; k++)
-			streamer->read(kin.quatRotation[k]);
-
-		// trasform in degrees
-		for (int k = 0; k < 4; k++)
-			kin.quatRotation[k] = XsMath_rad2deg(kin.quatRotation[k]);
-
-		m_data.push_back(kin);
-	}
+	// Segment ID, Sensor Position (3 x 4 byte) and Quaternion Rotation (4 x 4 byte) are all big endian 32 bit fields
+	return decodeRecords<Layout>(inputStreamer, m_outlets);
 }
-lsl::stream_info QuaternionDatagram::info[2] = {
-	lsl::stream_info("QuaternionDatagram1", "MoCap", 23 * (3 + 4), lsl::IRREGULAR_RATE, lsl::cf_float32, "qd1"),
-	lsl::stream_info("QuaternionDatagram2", "MoCap", 23 * (3 + 4), lsl::IRREGULAR_RATE, lsl::cf_float32, "qd2")
-};
-
-// Create the streams with that stream info
-lsl::stream_outlet QuaternionDatagram::outlet[2] = {
-	{ QuaternionDatagram::info[0] },
-	{ QuaternionDatagram::info[1] },
-};
-
-std::vector<float> QuaternionDatagram::alignData() const {
-	std::vector<float> ret;
-	for (auto s : m_data) {
-		for (auto p : s.sensorPos) ret.push_back(p);
-		for (auto q : s.quatRotation) ret.push_back(q);
-	}
-	return ret;
+/*! \returns the outlets of this datagram type */
+OutletRegistry *QuaternionDatagram::outlets()
+{
+	return &m_outlets;
+}
+
+/*! \returns the decoded records */
+const float *QuaternionDatagram::sample(size_t &count)
+{
+	return recordSample<Layout>(m_outlets, count);
 }
 
-void QuaternionDatagram::streamData() const {
-	std::vector<float> val = alignData();
-	outlet[avatarId()].push_sample(val);
+void QuaternionDatagram::streamData() {
+	streamRecords<Layout>(m_outlets);
 }
 
 /*! Print Data datagram in a formated why
 */
-void QuaternionDatagram::printData() const
+void QuaternionDatagram::printData()
 {
 	streamData();
 }
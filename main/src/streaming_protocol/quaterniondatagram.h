@@ -28,29 +28,32 @@
 #define QUATERNIONDATAGRAM_H
 
 #include "datagram.h"
+#include "outletregistry.h"
+#include "recordlayout.h"
 
 class QuaternionDatagram : public Datagram {
 public:
 	QuaternionDatagram();
 	virtual ~QuaternionDatagram();
-	virtual void printData() const override;
+	virtual void printData() override;
+	virtual OutletRegistry *outlets() override;
+	virtual const float *sample(size_t &count) override;
 
 protected:
-	virtual void deserializeData(Streamer &inputStreamer) override;
+	virtual bool deserializeData(Streamer &inputStreamer) override;
 	
 private:
-	struct Kinematics {
-		int segmentId;
-		float sensorPos[3];
-		float quatRotation[4];
-	};
-
-	std::vector<Kinematics> m_data;
+	/*! One segment on the wire, the quaternion rotation is streamed in degrees */
+	typedef RecordLayout::Record<
+		RecordLayout::Skip<1>,					// segment id
+		RecordLayout::Float<3>,					// sensor position
+		RecordLayout::Float<4, Rad2Deg>			// quaternion rotation
+	> Layout;
+
+	// the outlets per avatar, the records are decoded straight into their sample buffers
+	OutletRegistry m_outlets;
 public:
-	std::vector<float> alignData() const;
-	void streamData() const;
-	static lsl::stream_info info[2];
-	static lsl::stream_outlet outlet[2];
+	void streamData();
 };
 
 #endif
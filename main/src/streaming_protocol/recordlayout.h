@@ -0,0 +1,158 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef RECORDLAYOUT_H
+#define RECORDLAYOUT_H
+
+#include "streamer.h"
+#include <cstring>
+
+/*! \namespace RecordLayout
+	\brief Compile-time descriptions of the fixed-size records of the kinematics datagrams
+
+	A record is described as a list of fields, each spanning a number of big endian 32 bit words.
+	A field tells whether its words become LSL channels and which transform is applied to them.
+	Record<...>::decode() expands the list at compile time, so every protocol gets its own unrolled
+	kernel that goes from the words of a record straight to a float buffer in channel order.
+
+	decodeRecords() first swaps a block of records to host order with the vectorized
+	Streamer::fromBigEndian32(), the fields then only pick and transform the swapped words.
+*/
+namespace RecordLayout
+{
+	/*! Leave the values unchanged */
+	struct Identity
+	{
+		template <size_t Count>
+		static void apply(float*) {}
+	};
+
+	/*! Apply \a First and then \a Second */
+	template <typename First, typename Second>
+	struct Chain
+	{
+		template <size_t Count>
+		static void apply(float* values)
+		{
+			First::template apply<Count>(values);
+			Second::template apply<Count>(values);
+		}
+	};
+
+	/*! \a Count float words that become channels after \a Transform is applied to them */
+	template <size_t Count, typename Transform = Identity>
+	struct Float
+	{
+		static constexpr size_t words() { return Count; }
+		static constexpr size_t channels() { return Count; }
+
+		static void decode(const uint32_t* source, float* destination)
+		{
+			memcpy(destination, source, Count * sizeof(float));
+			Transform::template apply<Count>(destination);
+		}
+	};
+
+	/*! \a Count signed integer words that become channels as floats */
+	template <size_t Count>
+	struct Int
+	{
+		static constexpr size_t words() { return Count; }
+		static constexpr size_t channels() { return Count; }
+
+		static void decode(const uint32_t* source, float* destination)
+		{
+			for (size_t i = 0; i < Count; i++)
+				destination[i] = static_cast<float>(static_cast<int32_t>(source[i]));
+		}
+	};
+
+	/*! \a Count words that are not streamed, such as the segment id */
+	template <size_t Count>
+	struct Skip
+	{
+		static constexpr size_t words() { return Count; }
+		static constexpr size_t channels() { return 0; }
+
+		static void decode(const uint32_t*, float*) {}
+	};
+
+	// the number of words swapped to host order at a time, a block lives on the stack
+	static const size_t BLOCKWORDS = 256;
+
+	/*! A record made of \a Fields in wire order */
+	template <typename... Fields>
+	struct Record;
+
+	template <>
+	struct Record<>
+	{
+		static constexpr size_t words() { return 0; }
+		static constexpr size_t channels() { return 0; }
+
+		static void decode(const uint32_t*, float*) {}
+	};
+
+	template <typename Field, typename... Rest>
+	struct Record<Field, Rest...>
+	{
+		static constexpr size_t words() { return Field::words() + Record<Rest...>::words(); }
+		static constexpr size_t channels() { return Field::channels() + Record<Rest...>::channels(); }
+
+		/*! The size of one record on the wire in bytes */
+		static constexpr size_t size() { return 4 * words(); }
+
+		/*! Decode the words() host order words at \a source into channels() floats at \a destination */
+		static void decode(const uint32_t* source, float* destination)
+		{
+			Field::decode(source, destination);
+			Record<Rest...>::decode(source + Field::words(), destination + Field::channels());
+		}
+
+		/*! Decode \a count consecutive big endian records at \a source into count * channels() floats at \a destination */
+		static void decodeRecords(const uint8_t* source, size_t count, float* destination)
+		{
+			static_assert(words() <= BLOCKWORDS, "a record must fit in a block");
+			static const size_t BLOCKRECORDS = BLOCKWORDS / words();
+
+			uint32_t block[BLOCKRECORDS * words()];
+			while (count > 0)
+			{
+				size_t records = count < BLOCKRECORDS ? count : BLOCKRECORDS;
+				Streamer::fromBigEndian32(source, block, records * words());
+				for (size_t i = 0; i < records; i++)
+				{
+					decode(block + i * words(), destination);
+					destination += channels();
+				}
+				source += records * size();
+				count -= records;
+			}
+		}
+	};
+}
+
+#endif
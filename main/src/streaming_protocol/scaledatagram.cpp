@@ -57,6 +57,18 @@ ScaleDatagram::~ScaleDatagram()
 {
 }
 
+/*! \returns true when \a avatar already has the segment names of the last null pose */
+bool ScaleDatagram::hasSegmentNames(const AvatarInfo &avatar) const
+{
+	if (avatar.segmentNames.size() != m_tPose.size())
+		return false;
+
+	for (size_t i = 0; i < m_tPose.size(); i++)
+		if (avatar.segmentNames[i] != m_tPose[i].segmentName)
+			return false;
+	return true;
+}
+
 /*! Deserialize the scale packets
 	The Scale packets are divided in parts, to avoid exceed the 1500 byte packet size limit. For a normal biped this results in a total of 5 packets.
 	To deserialize the packets whe should follow this rules:
@@ -64,30 +76,43 @@ ScaleDatagram::~ScaleDatagram()
 	- The points will end up with a varying number per datagram with 0 segments (Points Definitation packets).
 	- The last packet is the one that will end up in one datagram with 0 points.
 */
-void ScaleDatagram::deserializeData(Streamer &inputStreamer)
+bool ScaleDatagram::deserializeData(Streamer &inputStreamer)
 {
 	Streamer* streamer = &inputStreamer;
+
+	// the datagram is reused for every packet of its type, drop the previous data but keep the capacity
+	m_tPose.clear();
+	m_pointDefinitions.clear();
+
 	// The first packet contains the null pose definition. 
 
 	// 4 bytes: the number of segments as an unsigned integer
+	if (!streamer->canRead(4))
+		return false;
+
 	int32_t numberOfSegments = 0;
-	streamer->read((int32_t)numberOfSegments);
+	streamer->read(numberOfSegments);
 
 	for (int i=0; i < numberOfSegments; i++)
 	{
 		NullPoseDefinition nullPosDef;
 
 		// String: the name of the segment
+		if (!streamer->canRead(4))
+			return false;
+
 		int32_t stringSize = 0;
-		streamer->read((int32_t)stringSize);
+		streamer->read(stringSize);
+
+		if (stringSize < 0 || !streamer->canRead(stringSize + sizeof(nullPosDef.pos)))
+			return false;
 
 		std::string str;
  		streamer->read(str, stringSize);
 		nullPosDef.segmentName = str;
 
 		// 3-component vector: the position of the origin of the segment in the null pose
-		for (int k = 0; k < 3; k++)
-			streamer->read((float)nullPosDef.pos[k]);
+		streamer->read(nullPosDef.pos, 3);
 
 		m_tPose.push_back(nullPosDef);
 	}
@@ -98,45 +123,71 @@ void ScaleDatagram::deserializeData(Streamer &inputStreamer)
 	if (numberOfSegments == 0)
 	{
 		// 4 bytes containing an unsigned integer: the number of points
+		if (!streamer->canRead(4))
+			return false;
+
 		int32_t numberOfPoints = 0;
-		streamer->read((int32_t)numberOfPoints);
+		streamer->read(numberOfPoints);
 		for (int i=0; i < numberOfPoints; i++)
 		{
 			PointDefinition pointDef;
 
+			if (!streamer->canRead(2 + 2))
+				return false;
+
 			// 2 bytes: the id of the segment containing the point
-			streamer->read((int16_t)pointDef.segmentId);
+			streamer->read(pointDef.segmentId);
 
 			// 2 bytes: the point id of the point within the segment
-			streamer->read((int16_t)pointDef.pointId);
+			streamer->read(pointDef.pointId);
 
 			// The last packet is the one that will end up in one datagram with 0 points.
 			if (pointDef.pointId < 0) 
 				break;
 
 			// String: the name of the segment
+			if (!streamer->canRead(4))
+				return false;
+
 			int32_t stringSize = 0;
-			streamer->read((int32_t)stringSize);
+			streamer->read(stringSize);
+
+			if (stringSize < 0 || !streamer->canRead(stringSize + 4 + sizeof(pointDef.pos)))
+				return false;
+
 			std::string str;
  			streamer->read(str, stringSize);
 			pointDef.segmentName = str;
 
 			// 4 bytes: unsigned integer containing flags describing the points characteristics 
-			streamer->read((int32_t)pointDef.characteristicOfPoint);
+			streamer->read(pointDef.characteristicOfPoint);
 
 			// 3-component vector: the position of the point relative to the segment origin in the null pose
-			for (int k = 0; k < 3; k++)
-				streamer->read((float)pointDef.pos[k]);
+			streamer->read(pointDef.pos, 3);
 
 			m_pointDefinitions.push_back(pointDef);
 		}
 	}
+
+	// the outlets of this avatar describe their streams with the segment names. Only the null pose packet
+	// names the segments, and a change of the names re-creates the outlets, so the point definition packets
+	// and repeats of the same names leave them alone.
+	if (avatarInfoTable() && !m_tPose.empty() && !hasSegmentNames(avatarInfoTable()->info(avatarId())))
+	{
+		std::vector<std::string> segmentNames;
+		segmentNames.reserve(m_tPose.size());
+		for (const NullPoseDefinition &segment : m_tPose)
+			segmentNames.push_back(segment.segmentName);
+		avatarInfoTable()->setSegmentNames(avatarId(), segmentNames);
+	}
+
+	return true;
 }
 
 
 
 /*! Print Data datagram in a formated why
 */
-void ScaleDatagram::printData() const
+void ScaleDatagram::printData()
 {
 }
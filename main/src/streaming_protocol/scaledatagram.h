@@ -35,10 +35,10 @@ public:
 	ScaleDatagram();
 	virtual ~ScaleDatagram();
 
-	virtual void printData() const override;
+	virtual void printData() override;
 
 protected:
-	virtual void deserializeData(Streamer &inputStreamer) override;
+	virtual bool deserializeData(Streamer &inputStreamer) override;
 
 private:
 
@@ -55,6 +55,8 @@ private:
 		float pos[3];
 	};
 
+	bool hasSegmentNames(const AvatarInfo &avatar) const;
+
 	std::vector<NullPoseDefinition> m_tPose;
 	std::vector<PointDefinition> m_pointDefinitions;
 };
@@ -0,0 +1,215 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "senderclock.h"
+#include <cmath>
+#include <algorithm>
+
+/*! Weight of the previous fit for every new frame, about the last 1000 frames determine the fit */
+static const double FORGETFACTOR = 0.999;
+
+/*! Number of frames that are accepted unconditionally before outliers are rejected */
+static const size_t WARMUPFRAMES = 32;
+
+/*! A frame is an outlier when its residual exceeds this many times the mean absolute residual... */
+static const double OUTLIERSPREADS = 5.0;
+
+/*! ...and this many seconds, so a perfectly regular stream does not reject every small disturbance */
+static const double OUTLIERMINIMUM = 0.002;
+
+/*! Number of consecutive outliers after which the sender clock is assumed to have jumped */
+static const size_t RESETOUTLIERS = 50;
+
+/*! Frames that are at most this many milliseconds older than the newest one were reordered on the way,
+	older frames mean the sender clock was reset */
+static const int32_t REORDERWINDOW_MS = 1000;
+
+/*! Rate in seconds per second at which the lower envelope of the residuals relaxes upwards */
+static const double ENVELOPERELAX = 0.001;
+
+/*! \class SenderClock
+  \brief Maps the frame time of the sender to lsl::local_clock()
+
+  MVN Studio stamps every datagram with the frame time in milliseconds. The receive times of the frames
+  are fitted to a line, time = offset + rate * frameTime, by exponentially weighted least squares, so the
+  rate follows the drift between the two clocks. Frames that arrive much later or earlier than the line
+  predicts, because they were delayed in the network or the receive queue, do not update the fit.
+  When many frames in a row are outliers, or the frame time jumps backwards, the sender was restarted
+  or paused and the fit starts over.
+
+  The line runs through the mean receive delay. The timestamp of a frame is shifted down to the lower
+  envelope of the receive times, which is the best estimate of the capture time, offset by the minimal
+  transport delay, that the receive times allow.
+ */
+
+/*! Constructor */
+SenderClock::SenderClock()
+	: m_baseFrameTime(0)
+	, m_baseReceiveTime(0)
+	, m_lastFrameTime(0)
+	, m_started(false)
+	, m_sw(0), m_sx(0), m_sxx(0), m_sy(0), m_sxy(0)
+	, m_sampleCount(0)
+	, m_offset(0)
+	, m_rate(1)
+	, m_spread(0)
+	, m_envelope(0)
+	, m_lastX(0)
+	, m_consecutiveOutliers(0)
+	, m_outlierCount(0)
+	, m_resetCount(0)
+{
+}
+
+/*! Return the local clock time of the frame with \a frameTime that was received at \a receiveTime
+
+	Every datagram of a frame carries the same frame time, only the first one of a new frame updates the fit,
+	reordered frames are only mapped. Until the fit has two frames the receive time is returned as is.
+*/
+double SenderClock::timestamp(int32_t frameTime, double receiveTime)
+{
+	if (!m_started)
+		reset(frameTime, receiveTime);
+	else if (frameTime < m_lastFrameTime - REORDERWINDOW_MS)
+	{
+		m_resetCount++;
+		reset(frameTime, receiveTime);
+	}
+
+	double x = (frameTime - m_baseFrameTime) / 1000.0;
+
+	if (frameTime > m_lastFrameTime || m_sampleCount == 0)
+	{
+		double y = receiveTime - m_baseReceiveTime;
+		double residual = y - predict(x);
+
+		if (m_sampleCount >= WARMUPFRAMES && std::fabs(residual) > std::max(OUTLIERSPREADS * m_spread, OUTLIERMINIMUM))
+		{
+			m_outlierCount++;
+			if (++m_consecutiveOutliers >= RESETOUTLIERS)
+			{
+				m_resetCount++;
+				reset(frameTime, receiveTime);
+				update(0, 0);
+			}
+		}
+		else
+		{
+			m_consecutiveOutliers = 0;
+			update(x, y);
+		}
+
+		m_lastFrameTime = frameTime;
+	}
+
+	if (m_sampleCount < 2)
+		return receiveTime;
+
+	return m_baseReceiveTime + predict(x) + m_envelope;
+}
+
+/*! \returns true once enough frames were fitted to reject outliers */
+bool SenderClock::isLocked() const
+{
+	return m_sampleCount >= WARMUPFRAMES;
+}
+
+/*! \returns the relative rate difference of the local clock and the sender clock, e.g. 1e-5 for 10 ppm */
+double SenderClock::drift() const
+{
+	return m_rate - 1.0;
+}
+
+/*! \returns the number of frames that were not used for the fit */
+size_t SenderClock::outlierCount() const
+{
+	return m_outlierCount;
+}
+
+/*! \returns the number of times the fit started over */
+size_t SenderClock::resetCount() const
+{
+	return m_resetCount;
+}
+
+/*! Start a new fit at the frame with \a frameTime received at \a receiveTime */
+void SenderClock::reset(int32_t frameTime, double receiveTime)
+{
+	m_baseFrameTime = frameTime;
+	m_baseReceiveTime = receiveTime;
+	m_lastFrameTime = frameTime;
+	m_started = true;
+
+	m_sw = m_sx = m_sxx = m_sy = m_sxy = 0;
+	m_sampleCount = 0;
+	m_offset = 0;
+	m_rate = 1;
+	m_spread = 0;
+	m_envelope = 0;
+	m_lastX = 0;
+	m_consecutiveOutliers = 0;
+}
+
+/*! Add the frame at \a x seconds sender time received \a y seconds after the start of the fit */
+void SenderClock::update(double x, double y)
+{
+	double residual = y - predict(x);
+
+	m_sw = FORGETFACTOR * m_sw + 1;
+	m_sx = FORGETFACTOR * m_sx + x;
+	m_sxx = FORGETFACTOR * m_sxx + x * x;
+	m_sy = FORGETFACTOR * m_sy + y;
+	m_sxy = FORGETFACTOR * m_sxy + x * y;
+	m_sampleCount++;
+
+	double det = m_sw * m_sxx - m_sx * m_sx;
+	if (m_sampleCount >= 2 && det > 1e-12)
+	{
+		m_rate = (m_sw * m_sxy - m_sx * m_sy) / det;
+		m_offset = (m_sy - m_rate * m_sx) / m_sw;
+	}
+	else
+		m_offset = m_sy / m_sw - m_rate * m_sx / m_sw;
+
+	// a plain mean during the warm up, so the first frames do not dominate the spread
+	double weight = m_sampleCount <= WARMUPFRAMES ? 1.0 / m_sampleCount : 1.0 - FORGETFACTOR;
+	m_spread += weight * (std::fabs(residual) - m_spread);
+
+	// the envelope follows the earliest arrivals and slowly lets go of them, so it tracks the drift,
+	// it starts once the fit settled so the first unstable fits do not pull it down
+	if (m_sampleCount > WARMUPFRAMES)
+	{
+		double relaxed = m_envelope + ENVELOPERELAX * std::max(0.0, x - m_lastX);
+		m_envelope = std::min(relaxed, y - predict(x));
+	}
+	m_lastX = x;
+}
+
+/*! \returns the receive time the fit predicts for \a x seconds sender time, relative to the start of the fit */
+double SenderClock::predict(double x) const
+{
+	return m_offset + m_rate * x;
+}
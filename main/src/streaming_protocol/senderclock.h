@@ -0,0 +1,70 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SENDERCLOCK_H
+#define SENDERCLOCK_H
+
+#include <cstdint>
+#include <cstddef>
+
+class SenderClock
+{
+public:
+	SenderClock();
+
+	double timestamp(int32_t frameTime, double receiveTime);
+
+	bool isLocked() const;
+	double drift() const;
+	size_t outlierCount() const;
+	size_t resetCount() const;
+
+private:
+	void reset(int32_t frameTime, double receiveTime);
+	void update(double x, double y);
+	double predict(double x) const;
+
+	int32_t m_baseFrameTime;
+	double m_baseReceiveTime;
+	int32_t m_lastFrameTime;
+	bool m_started;
+
+	// exponentially weighted sums of the least squares fit of receive time y over frame time x
+	double m_sw, m_sx, m_sxx, m_sy, m_sxy;
+	size_t m_sampleCount;
+	double m_offset, m_rate;
+
+	// the mean absolute residual and the lower envelope of the residuals
+	double m_spread;
+	double m_envelope;
+	double m_lastX;
+
+	size_t m_consecutiveOutliers;
+	size_t m_outlierCount;
+	size_t m_resetCount;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "sequencetracker.h"
+
+/*! \class SequenceTracker
+  \brief Tells network loss and reordering apart on the receive path
+
+  Every datagram of a stream carries the sample counter of its frame, which the sender increments by one per
+  frame. Compared to the newest counter of its stream a datagram is in order when it is the next one, follows
+  a gap when counters were skipped, or is late when it is older. An older counter that was already received is
+  a duplicate. The counters received are remembered for the 64 frames before the newest one, an older datagram
+  is always counted as late.
+
+  The sender may skip frames itself, so a gap is not necessarily network loss. A late datagram that fills a
+  gap is taken off the missed samples again, so what remains missed did not arrive at all.
+ */
+
+// the number of frames before the newest one whose arrival is remembered
+static const int32_t WINDOW = 64;
+
+// a counter this far behind the newest one means the sender restarted, the stream starts over
+static const int32_t RESYNCDISTANCE = 1000;
+
+/*! Constructor, the default streams every datagram */
+SequencePolicy::SequencePolicy(bool dropLate, bool dropDuplicates)
+	: dropLate(dropLate)
+	, dropDuplicates(dropDuplicates)
+{
+}
+
+/*! Constructor
+	\param policy Which of the out of sequence datagrams isDropped() reports
+*/
+SequenceTracker::SequenceTracker(const SequencePolicy &policy)
+	: m_policy(policy)
+	, m_inOrderCount(0)
+	, m_gapCount(0)
+	, m_missedCount(0)
+	, m_duplicateCount(0)
+	, m_lateCount(0)
+	, m_resyncCount(0)
+{
+}
+
+/*! Classify the datagram with \a sampleCounter of the stream of \a avatarId and \a messageType and count it
+
+	The first datagram of a stream is in order.
+*/
+SequenceTracker::Arrival SequenceTracker::track(uint8_t avatarId, int messageType, int32_t sampleCounter)
+{
+	std::unique_ptr<AvatarSequences> &avatar = m_avatars[avatarId];
+	if (!avatar)
+	{
+		avatar.reset(new AvatarSequences);
+		for (Sequence &sequence : *avatar)
+			sequence.started = false;
+	}
+
+	Sequence &sequence = (*avatar)[messageType & 0xFF];
+	int32_t distance = (int32_t)((uint32_t)sampleCounter - (uint32_t)sequence.newest);
+
+	if (sequence.started && distance < -RESYNCDISTANCE)
+	{
+		m_resyncCount.fetch_add(1, std::memory_order_relaxed);
+		sequence.started = false;
+	}
+
+	if (!sequence.started || distance == 1)
+	{
+		sequence.received = sequence.started ? sequence.received << 1 | 1 : 1;
+		sequence.skipped = sequence.started ? sequence.skipped << 1 : 0;
+		sequence.started = true;
+		sequence.newest = sampleCounter;
+		m_inOrderCount.fetch_add(1, std::memory_order_relaxed);
+		return InOrder;
+	}
+
+	if (distance > 1)
+	{
+		sequence.received = distance < WINDOW ? sequence.received << distance | 1 : 1;
+		sequence.skipped = distance < WINDOW ? sequence.skipped << distance | (((uint64_t)1 << distance) - 2) : ~(uint64_t)1;
+		sequence.newest = sampleCounter;
+		m_gapCount.fetch_add(1, std::memory_order_relaxed);
+		m_missedCount.fetch_add(distance - 1, std::memory_order_relaxed);
+		return Gap;
+	}
+
+	// the newest counter is bit 0, older ones follow
+	int32_t age = -distance;
+	if (age >= WINDOW)
+	{
+		m_lateCount.fetch_add(1, std::memory_order_relaxed);
+		return Late;
+	}
+
+	uint64_t bit = (uint64_t)1 << age;
+	if (sequence.received & bit)
+	{
+		m_duplicateCount.fetch_add(1, std::memory_order_relaxed);
+		return Duplicate;
+	}
+
+	sequence.received |= bit;
+	m_lateCount.fetch_add(1, std::memory_order_relaxed);
+	if (sequence.skipped & bit)
+	{
+		sequence.skipped &= ~bit;
+		m_missedCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+	return Late;
+}
+
+/*! \returns true if a datagram with \a arrival should not be streamed according to the policy */
+bool SequenceTracker::isDropped(Arrival arrival) const
+{
+	return (arrival == Late && m_policy.dropLate) || (arrival == Duplicate && m_policy.dropDuplicates);
+}
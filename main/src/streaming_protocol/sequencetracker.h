@@ -0,0 +1,95 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SEQUENCETRACKER_H
+#define SEQUENCETRACKER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/*! Which out of sequence datagrams are dropped before they are streamed */
+struct SequencePolicy
+{
+	SequencePolicy(bool dropLate = false, bool dropDuplicates = false);
+
+	// drop datagrams that arrive after a newer one of their stream
+	bool dropLate;
+	// drop datagrams whose sample counter was already received
+	bool dropDuplicates;
+};
+
+/*! Follows the sample counter of every stream, one per avatar and message type */
+class SequenceTracker
+{
+public:
+	/*! How a datagram relates to the ones received before it on its stream */
+	enum Arrival
+	{
+		InOrder,
+		Gap,
+		Duplicate,
+		Late
+	};
+
+	SequenceTracker(const SequencePolicy &policy = SequencePolicy());
+
+	Arrival track(uint8_t avatarId, int messageType, int32_t sampleCounter);
+	bool isDropped(Arrival arrival) const;
+
+	// statistics, safe to read from any thread
+	size_t inOrderCount() const { return m_inOrderCount.load(std::memory_order_relaxed); }
+	size_t gapCount() const { return m_gapCount.load(std::memory_order_relaxed); }
+	size_t missedCount() const { return m_missedCount.load(std::memory_order_relaxed); }
+	size_t duplicateCount() const { return m_duplicateCount.load(std::memory_order_relaxed); }
+	size_t lateCount() const { return m_lateCount.load(std::memory_order_relaxed); }
+	size_t resyncCount() const { return m_resyncCount.load(std::memory_order_relaxed); }
+
+private:
+	/*! The newest sample counter of a stream and which of the 64 before it were received or skipped */
+	struct Sequence
+	{
+		bool started;
+		int32_t newest;
+		uint64_t received;
+		uint64_t skipped;
+	};
+
+	typedef std::array<Sequence, 256> AvatarSequences;
+
+	SequencePolicy m_policy;
+	std::array<std::unique_ptr<AvatarSequences>, 256> m_avatars;
+
+	std::atomic<size_t> m_inOrderCount;
+	std::atomic<size_t> m_gapCount;
+	std::atomic<size_t> m_missedCount;
+	std::atomic<size_t> m_duplicateCount;
+	std::atomic<size_t> m_lateCount;
+	std::atomic<size_t> m_resyncCount;
+};
+
+#endif
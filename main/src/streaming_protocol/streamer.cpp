@@ -25,6 +25,14 @@
 */
 
 #include "streamer.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STREAMER_SSE2
+#endif
 
 /*!
 	Intel processors use "Little Endian" byte order:
@@ -41,24 +49,17 @@
 	Base_Address+1 Byte2
 	Base_Address+2 Byte1
 	Base_Address+3 Byte0
+
+	The network data is big endian. The byte order of the host is fixed at compile time (see
+	Streamer::HOSTISBIGENDIAN), so the conversion does not have to be decided for every value.
 */
 
-Streamer::Streamer(const XsByteArray& arr) 
+Streamer::Streamer(const uint8_t* data, size_t size)
 	: m_offset(0)
 {
 	// reference to the real data
-	m_array = &arr;
-
-	// check Endianess
-	int num = 1;
-	if(*(char *)&num == 1)
-	{
-		m_endianess = Little_Endian;
-	}
-	else
-	{
-		m_endianess = Big_Endian;
-	}
+	m_data = data;
+	m_size = size;
 }
 
 /*! Destructor */
@@ -69,15 +70,7 @@ Streamer::~Streamer()
 /*! Extract 4 byte from the ByteArray and Store the value into a int32_t (4 byte) variable */
 void Streamer::read(int32_t &destination)
 {
-	char byte_array[4];
-
-	// copy part of the original byte array into a temp array 
-	memcpy(byte_array, m_array->data()+m_offset, sizeof(destination));
-
-	if (m_endianess == Little_Endian)
-		destination = byte_array[0] << 24 | (byte_array[1] & 0xff) << 16 | (byte_array[2] & 0xff) << 8| (byte_array[3] & 0xff);
-	else
-		destination = byte_array[3] << 24 | (byte_array[2] & 0xff) << 16 | (byte_array[1] & 0xff) << 8| (byte_array[0] & 0xff);
+	destination = (int32_t)loadBigEndian32(m_data + m_offset);
 
 	// increase the index
 	m_offset += 4;
@@ -88,7 +81,7 @@ void Streamer::read(int8_t &destination)
 {
 	int8_t res;
 
-	memcpy(&res, m_array->data()+m_offset, 1);
+	memcpy(&res, m_data+m_offset, 1);
 	destination = (int)res & 0xFF;
 
 	// increase the index
@@ -98,16 +91,8 @@ void Streamer::read(int8_t &destination)
 /*! Extract 2 byte from the ByteArray and Store the value into a int16_t (2 byte) variable */
 void Streamer::read(int16_t &destination)
 {
-	char byte_array[2];
+	destination = (int16_t)(m_data[m_offset] << 8 | m_data[m_offset + 1]);
 
-	// copy part of the original byte array into a temp array 
-	memcpy(byte_array, m_array->data()+m_offset, 2);
-
-	if (m_endianess == Little_Endian)
-		destination = 0x00 << 24 | 0x00 << 16 | (byte_array[0] & 0xff) << 8 | (byte_array[1] & 0xff);
-	else
-		destination = 0x00 << 24 | 0x00 << 16 | (byte_array[1] & 0xff) << 8 | (byte_array[0] & 0xff);
-	
 	// increase the index
 	m_offset += 2;
 }
@@ -117,7 +102,7 @@ void Streamer::read(uint8_t &destination)
 {
 	uint8_t res;
 
-	memcpy(&res, m_array->data()+m_offset, 1);
+	memcpy(&res, m_data+m_offset, 1);
 	destination = (int)res & 0xFF;
 
 	// increase the index
@@ -127,28 +112,8 @@ void Streamer::read(uint8_t &destination)
 /*! Extract 4 byte from the ByteArray and Store the value into a float (4 byte) variable */
 void Streamer::read(float &destination)
 {
-	float output = 0.0;
-
-	unsigned char byte_array[4];
-	// copy part of the original byte array into a temp array 
-	memcpy(&byte_array, m_array->data()+m_offset, sizeof(destination));
-
-	if (m_endianess == Little_Endian)
-	{
-		*((unsigned char*)(&output) + 3) = byte_array[0];
-		*((unsigned char*)(&output) + 2) = byte_array[1];
-		*((unsigned char*)(&output) + 1) = byte_array[2];
-		*((unsigned char*)(&output) + 0) = byte_array[3];
-	}
-	else
-	{
-		*((unsigned char*)(&output) + 3) = byte_array[3];
-		*((unsigned char*)(&output) + 2) = byte_array[2];
-		*((unsigned char*)(&output) + 1) = byte_array[1];
-		*((unsigned char*)(&output) + 0) = byte_array[0];
-	}
-
-	destination = output; 
+	uint32_t value = loadBigEndian32(m_data + m_offset);
+	memcpy(&destination, &value, sizeof(destination));
 
 	// increase the index
 	m_offset += 4;
@@ -159,7 +124,7 @@ void Streamer::read(std::string& str, int numChars)
 {
 	char * buffer = new char[numChars + 1];
 
-	memcpy(buffer, m_array->data()+m_offset, numChars);
+	memcpy(buffer, m_data+m_offset, numChars);
 	buffer[numChars] = '\0';
 
 	str = buffer;
@@ -168,3 +133,67 @@ void Streamer::read(std::string& str, int numChars)
 	// increase the index
 	m_offset += numChars;
 }
+
+/*! Extract \a count consecutive 4 byte values and store them into the int32_t array \a destination */
+void Streamer::read(int32_t* destination, size_t count)
+{
+	read32(destination, count);
+}
+
+/*! Extract \a count consecutive 4 byte values and store them into the float array \a destination */
+void Streamer::read(float* destination, size_t count)
+{
+	read32(destination, count);
+}
+
+/*! Convert \a count consecutive 32 bit values into \a destination and advance the index */
+void Streamer::read32(void* destination, size_t count)
+{
+	fromBigEndian32(m_data + m_offset, destination, count);
+
+	// increase the index
+	m_offset += (int)(count * 4);
+}
+
+/*! Convert the \a count big endian 32 bit values at \a source to host order and store them at \a destination
+
+	Whole blocks are swapped with AVX2 or SSE2 when the compiler targets them, the remainder is swapped one value at a time.
+	\a source and \a destination do not have to be aligned.
+*/
+void Streamer::fromBigEndian32(const uint8_t* source, void* destination, size_t count)
+{
+	uint8_t* dest = (uint8_t*)destination;
+
+	if (HOSTISBIGENDIAN)
+	{
+		memcpy(dest, source, count * 4);
+		return;
+	}
+
+	size_t i = 0;
+#if defined(__AVX2__)
+	const __m256i mask = _mm256_setr_epi8(
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(source + i * 4));
+		_mm256_storeu_si256((__m256i*)(dest + i * 4), _mm256_shuffle_epi8(v, mask));
+	}
+#elif defined(STREAMER_SSE2)
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(source + i * 4));
+		// swap the bytes of each 16 bit half, then swap the halves
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+		v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm_storeu_si128((__m128i*)(dest + i * 4), v);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		uint32_t value = loadBigEndian32(source + i * 4);
+		memcpy(dest + i * 4, &value, sizeof(value));
+	}
+}
@@ -30,13 +30,21 @@
 #include <memory>
 #include <iostream>
 #include <sstream>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
 
-#include <xsens/xsbytearray.h>
+#ifdef _MSC_VER
+#include <stdlib.h>
+#define STREAMER_BSWAP32(x) _byteswap_ulong(x)
+#else
+#define STREAMER_BSWAP32(x) __builtin_bswap32(x)
+#endif
 
 class Streamer
 {
 public:
-	Streamer(const XsByteArray& arr);
+	Streamer(const uint8_t* data, size_t size);
 	~Streamer();
 
 	void read(int32_t &destination);
@@ -46,16 +54,43 @@ public:
 	void read(float &destination);
 	void read(std::string& str, int numChars);
 
+	/*! Return whether \a bytes more bytes can be read */
+	bool canRead(size_t bytes) const { return bytes <= m_size - m_offset; }
+	size_t remaining() const { return m_size - m_offset; }
+
+	void read(int32_t* destination, size_t count);
+	void read(float* destination, size_t count);
+
+	/*! Decode \a count records described by the RecordLayout \a Layout into their channels at \a destination */
+	template <typename Layout>
+	void readLayout(float* destination, size_t count)
+	{
+		Layout::decodeRecords(m_data + m_offset, count, destination);
+		m_offset += static_cast<int>(count * Layout::size());
+	}
+
+	static void fromBigEndian32(const uint8_t* source, void* destination, size_t count);
+
+	/*! Convert the big endian 32 bit value in \a bytes to host order */
+	static uint32_t loadBigEndian32(const uint8_t* bytes)
+	{
+		uint32_t value;
+		memcpy(&value, bytes, sizeof(value));
+		return HOSTISBIGENDIAN ? value : STREAMER_BSWAP32(value);
+	}
+
 private:
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	static constexpr bool HOSTISBIGENDIAN = true;
+#else
+	static constexpr bool HOSTISBIGENDIAN = false;
+#endif
 
-	enum Endianess  {
-		Little_Endian,
-		Big_Endian
-	};
+	void read32(void* destination, size_t count);
 
-	const XsByteArray* m_array;
+	const uint8_t* m_data;
+	size_t m_size;
 	int m_offset;
-	Endianess m_endianess;
 };
 
 #endif
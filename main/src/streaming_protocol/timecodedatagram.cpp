@@ -25,6 +25,7 @@
 */
 
 #include "timecodedatagram.h"
+#include <cstdio>
 
 /*! \class TimeCodeDatagram
 	\brief a Time Code datagram (type 0x25)
@@ -52,10 +53,13 @@ TimeCodeDatagram::~TimeCodeDatagram()
 /*! Deserialize the data from \a arr
 	\sa serializeData
 */
-void TimeCodeDatagram::deserializeData(Streamer &inputStreamer)
+bool TimeCodeDatagram::deserializeData(Streamer &inputStreamer)
 {
 	Streamer* streamer = &inputStreamer;
 
+	if (!streamer->canRead(4 + 12))
+		return false;
+
 	int32_t stringSize = 0;
 	streamer->read(stringSize);
 
@@ -63,50 +67,23 @@ void TimeCodeDatagram::deserializeData(Streamer &inputStreamer)
 	streamer->read(str, 12);
 	int h,m,s,n;
 	
-	sscanf(str.c_str(), "%d:%d:%d.%d", &h, &m, &s, &n);
+	if (sscanf(str.c_str(), "%d:%d:%d.%d", &h, &m, &s, &n) != 4)
+		return false;
+
 	m_hour = h;
 	m_minute = m;
 	m_second = s;
 	m_nano = 1000000*n;
-}
-/*
-lsl::stream_info TimeCodeDatagram::info[2] = {
-	lsl::stream_info("TimeCode1", "MoCap", 4, 60),
-	lsl::stream_info("TimeCode2", "MoCap", 4, 60)
-};
-
-// Create the streams with that stream info
-lsl::stream_outlet TimeCodeDatagram::outlet[2] = {
-	{ TimeCodeDatagram::info[0] , 60},
-{ TimeCodeDatagram::info[1] , 60},
-};
-*/
-std::array<std::vector<std::vector<int32_t> >, 2> TimeCodeDatagram::buffer;
-std::array<int, 2> TimeCodeDatagram::buffer_prog{ 0, 0 };
 
-std::vector<int32_t> TimeCodeDatagram::alignData() const {
-	return std::vector<int32_t>{ m_hour, m_minute, m_second, m_nano };
+	return true;
 }
-
-void TimeCodeDatagram::streamData() const {
-	/*
-	buffer[avatarId()];
-	if (buffer_prog[avatarId()] < 8) {
-		buffer[avatarId()].push_back(alignData());
-	}
-	else {
-		//std::cout << outlet[avatarId()].info().nominal_srate() << std::endl;
-		outlet[avatarId()].push_chunk(buffer[avatarId()]);
-		buffer[avatarId()].clear();
-		buffer_prog[avatarId()] = 0;
-	}
-	++buffer_prog[avatarId()];
-	*/
+/*! The time code is not streamed, chunked pushing for the other streams is configured with ChunkPolicies */
+void TimeCodeDatagram::streamData() {
 }
 
 /*! Print Time Code datagram in a formated why
 */
-void TimeCodeDatagram::printData() const
+void TimeCodeDatagram::printData()
 {
 	streamData();
 }
@@ -34,10 +34,10 @@ class TimeCodeDatagram : public Datagram {
 public:
 	TimeCodeDatagram();
 	virtual ~TimeCodeDatagram();
-	virtual void printData() const override;
+	virtual void printData() override;
 
 protected:
-	virtual void deserializeData(Streamer &inputStreamer) override;
+	virtual bool deserializeData(Streamer &inputStreamer) override;
 
 private:
 	long int	m_nano;
@@ -52,14 +52,7 @@ public:
 		signed char m_second;
 		long int m_nano;
 	};
-	std::vector<int32_t> alignData() const;
-	void streamData() const;
-	static lsl::stream_info info[2];
-	static lsl::stream_outlet outlet[2];
-
-	static std::array<std::vector<std::vector<int32_t>>, 2> buffer;
-	static std::array<int, 2> buffer_prog;
-
+	void streamData();
 };
 
 #endif
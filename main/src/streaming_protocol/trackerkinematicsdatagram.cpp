@@ -57,6 +57,7 @@
 /*! Constructor */
 TrackerKinematicsDatagram::TrackerKinematicsDatagram()
 	: Datagram()
+	, m_outlets("TrackerKinematicsDatagram", "tkd")
 {
 	setType(SPTrackerKinematics);
 }
@@ -70,72 +71,34 @@ TrackerKinematicsDatagram::~TrackerKinematicsDatagram()
 /*! Deserialize the data from \a arr
 	\sa serializeData
 */
-void TrackerKinematicsDatagram::deserializeData(Streamer &inputStreamer)
+bool TrackerKinematicsDatagram::deserializeData(Streamer &inputStreamer)
 {
-	Streamer* streamer = &inputStreamer;
+	static_assert(Layout::size() == 68, "Layout must match the 68 byte sensor layout");
 
-	for (int i = 0; i < dataCount(); i++)
-	{
-		Kinematics kin;
-
-		// 4 byte
-		streamer->read(kin.segmentId);
-
-		// Store the Sensor rotation in a Vector -> 16 byte	(4 x 4 byte)
-		for (int k = 0; k < 4; k++)
-			streamer->read((float)kin.sens_rot[k]);
-
-		// Store the Sensor free acceleration in a Vector -> 12 byte	(3 x 4 byte)
-		for (int k = 0; k < 3; k++)
-			streamer->read((float)kin.sen_freeAcc[k]);
-
-		// Store the  Sensor Acceleration in a Vector -> 12 byte	(3 x 4 byte)
-		for (int k = 0; k < 3; k++)
-			streamer->read((float)kin.sen_acc[k]);
-
-		// Store the Sensor gyroscope in a Vector -> 12 byte	(3 x 4 byte)
-		for (int k = 0; k < 3; k++)
-			streamer->read((float)kin.sen_gyr[k]);
-
-		// Store the Sensor magnetometer a Vector -> 12 byte	(3 x 4 byte)
-		for (int k = 0; k < 3; k++)
-			streamer->read((float)kin.sen_mag[k]);
+	// Segment ID, Sensor rotation (4 x 4 byte), free acceleration, acceleration, gyroscope and
+	// magnetometer (4 x 3 x 4 byte) are all big endian 32 bit fields
+	return decodeRecords<Layout>(inputStreamer, m_outlets);
+}
 
-		m_data.push_back(kin);
-	}
+/*! \returns the outlets of this datagram type */
+OutletRegistry *TrackerKinematicsDatagram::outlets()
+{
+	return &m_outlets;
 }
 
-lsl::stream_info TrackerKinematicsDatagram::info[2] = {
-	lsl::stream_info("TrackerKinematicsDatagram1", "MoCap", 17 * (4 + 3 + 3 + 3 + 3), lsl::IRREGULAR_RATE, lsl::cf_float32, "tkd1"),
-	lsl::stream_info("TrackerKinematicsDatagram2", "MoCap", 17 * (4 + 3 + 3 + 3 + 3), lsl::IRREGULAR_RATE, lsl::cf_float32, "tkd2")
-};
-
-// Create the streams with that stream info
-lsl::stream_outlet TrackerKinematicsDatagram::outlet[2] = {
-	{ TrackerKinematicsDatagram::info[0] },
-    { TrackerKinematicsDatagram::info[1] },
-};
-
-std::vector<float> TrackerKinematicsDatagram::alignData() const {
-	std::vector<float> ret;
-	for (auto t : m_data) {
-		for (auto r : t.sens_rot) ret.push_back(r);
-		for (auto f : t.sen_freeAcc) ret.push_back(f);
-		for (auto a : t.sen_acc) ret.push_back(a);
-		for (auto g : t.sen_gyr) ret.push_back(g);
-		for (auto m : t.sen_mag) ret.push_back(m);
-	}
-	return ret;
+/*! \returns the decoded records */
+const float *TrackerKinematicsDatagram::sample(size_t &count)
+{
+	return recordSample<Layout>(m_outlets, count);
 }
 
-void TrackerKinematicsDatagram::streamData() const {
-	std::vector<float> val = alignData();
-	outlet[avatarId()].push_sample(val);
+void TrackerKinematicsDatagram::streamData() {
+	streamRecords<Layout>(m_outlets);
 }
 
 /*! Print Data datagram in a formated why
 */
-void TrackerKinematicsDatagram::printData() const
+void TrackerKinematicsDatagram::printData()
 {
 	streamData();
 }
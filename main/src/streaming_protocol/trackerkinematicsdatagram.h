@@ -28,33 +28,36 @@
 #define TRACKERSKINEMATICSDATAGRAM_H
 
 #include "datagram.h"
+#include "outletregistry.h"
+#include "recordlayout.h"
 
 class TrackerKinematicsDatagram : public Datagram {
 public:
 	TrackerKinematicsDatagram();
 	virtual ~TrackerKinematicsDatagram();
-	virtual void printData() const override;
+	virtual void printData() override;
+	virtual OutletRegistry *outlets() override;
+	virtual const float *sample(size_t &count) override;
 
 protected:
-	virtual void deserializeData(Streamer &inputStreamer) override;
+	virtual bool deserializeData(Streamer &inputStreamer) override;
 
 private:
-	struct Kinematics {
-		int segmentId;
-		float sens_rot[4];
-		float sen_freeAcc[3];
-		float sen_acc[3];
-		float sen_gyr[3];
-		float sen_mag[3];
-	};
-
-	std::vector<Kinematics> m_data;
+	/*! One sensor on the wire */
+	typedef RecordLayout::Record<
+		RecordLayout::Skip<1>,		// segment id
+		RecordLayout::Float<4>,		// sensor rotation
+		RecordLayout::Float<3>,		// free acceleration
+		RecordLayout::Float<3>,		// acceleration
+		RecordLayout::Float<3>,		// gyroscope
+		RecordLayout::Float<3>		// magnetometer
+	> Layout;
+
+	// the outlets per avatar, the records are decoded straight into their sample buffers
+	OutletRegistry m_outlets;
 
 public:
-	std::vector<float> alignData() const;
-	void streamData() const;
-	static lsl::stream_info info[2];
-	static lsl::stream_outlet outlet[2];
+	void streamData();
 };
 
 #endif
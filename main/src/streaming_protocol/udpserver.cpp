@@ -25,54 +25,432 @@
 */
 
 #include "udpserver.h"
+#include <algorithm>
+#include <chrono>
 
-DWORD WINAPI udpThreadFunc(LPVOID param)
-{
-	UdpServer* server = (UdpServer*) param;
-	server->readMessages();
-	return 0;
-}
+/*! Number of slots in the receive ring */
+static const size_t RINGSLOTCOUNT = 1024;
+
+/*! Size of a receive ring slot, MVN Studio splits its frames into datagrams that fit the Ethernet MTU */
+static const size_t RINGSLOTSIZE = 2048;
+
+/*! Number of empty polls after which the processing thread stops spinning and sleeps */
+static const int PROCESSINGSPINCOUNT = 1000;
+
+/*! Time the idle processing thread sleeps between polls of the ring */
+static const int PROCESSINGIDLE_US = 100;
+
+#ifndef _WIN32
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+/*! Receive timeout of the POSIX socket, this bounds the time it takes to notice a stop request */
+static const int RECEIVETIMEOUT_MS = 100;
 
-UdpServer::UdpServer(XsString address, uint16_t port)
-	: m_started(false)
+#endif
+
+/*! Construct a server listening on \a address and \a port
+
+	\param batchSize The maximum number of datagrams drained from the socket with a single system call.
+	Batching requires recvmmsg and is only used on Linux, other platforms receive one datagram per call.
+	\param chunkPolicies How the samples of each message type are pushed to LSL, see ChunkPolicies.
+	\param kernelTimestamps Stamp the datagrams with the time the kernel received them instead of the time
+	the receive thread read them, so scheduling delays of the receive thread stay out of the timestamps.
+	This uses SO_TIMESTAMPNS and is only available on Linux.
+	\param aggregationPolicy The message types that are also pushed as one combined sample per frame, see FrameAggregator.
+	\param sequencePolicy Which late and duplicate datagrams are dropped, see SequenceTracker.
+	\param jitterPolicy The playout delay of the samples, see JitterBuffer.
+	\param measureLatency Record the latency of the stages between the socket and LSL, see printLatency().
+	\param capturePath When not empty, every received datagram is recorded with its receive time in this file,
+	see CaptureWriter.
+*/
+UdpServer::UdpServer(const std::string& address, uint16_t port, int batchSize, const ChunkPolicies& chunkPolicies,
+	bool kernelTimestamps, const AggregationPolicy& aggregationPolicy, const SequencePolicy& sequencePolicy,
+	const JitterPolicy& jitterPolicy, bool measureLatency, const std::string& capturePath)
+	: m_kernelLatencyTotal(0)
+	, m_kernelLatencyMax(0)
+	, m_kernelLatencyCount(0)
+	, m_truncatedCount(0)
+	, m_started(false)
 	, m_stopping(false)
 {	
 	m_port = port;
 	m_hostName = address;
+	m_batchSize = batchSize < 1 ? 1 : batchSize;
+
+#if defined(__linux__)
+	m_kernelTimestamps = kernelTimestamps;
+#else
+	if (kernelTimestamps)
+		std::cout << "Kernel receive timestamps are only supported on Linux" << std::endl;
+	m_kernelTimestamps = false;
+#endif
 
-	m_parserManager.reset(new ParserManager());
+	m_parserManager.reset(new ParserManager(chunkPolicies, aggregationPolicy, sequencePolicy, jitterPolicy,
+		measureLatency));
+	m_ring.reset(new PacketRing(RINGSLOTCOUNT, RINGSLOTSIZE));
+
+	if (!capturePath.empty())
+	{
+		m_capture.reset(new CaptureWriter(capturePath));
+		if (m_capture->isOpen())
+			std::cout << "Capturing the datagrams to " << capturePath << std::endl;
+		else
+			m_capture.reset();
+	}
+
+	if ((size_t)m_batchSize > m_ring->capacity())
+		m_batchSize = (int)m_ring->capacity();
+
+#ifdef _WIN32
 	m_socket.reset(new XsSocket(IpProtocol::IP_UDP, NetworkLayerProtocol::NLP_IPV4));
 
 	XsResultValue res = m_socket->bind(m_hostName,m_port);
 
 	if (res == XRV_OK)
 		startThread();
+#else
+	m_socket = -1;
+
+	if (bind())
+		startThread();
+#endif
 }
 
 UdpServer::~UdpServer()
 {
 	stopThread();
+
+#ifndef _WIN32
+	if (m_socket >= 0)
+		close(m_socket);
+#endif
+}
+
+#ifndef _WIN32
+/*! Create the POSIX UDP socket and bind it to the host name and port
+	\returns true if the socket is ready to receive datagrams
+*/
+bool UdpServer::bind()
+{
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_protocol = IPPROTO_UDP;
+	hints.ai_flags = AI_PASSIVE;
+
+	addrinfo* addresses = nullptr;
+	std::string service = std::to_string(m_port);
+	int rv = getaddrinfo(m_hostName.empty() ? nullptr : m_hostName.c_str(), service.c_str(), &hints, &addresses);
+	if (rv != 0)
+	{
+		std::cout << "Unable to resolve " << m_hostName << ": " << gai_strerror(rv) << std::endl;
+		return false;
+	}
+
+	for (addrinfo* ai = addresses; ai != nullptr; ai = ai->ai_next)
+	{
+		m_socket = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (m_socket < 0)
+			continue;
+
+		if (::bind(m_socket, ai->ai_addr, ai->ai_addrlen) == 0)
+			break;
+
+		close(m_socket);
+		m_socket = -1;
+	}
+	freeaddrinfo(addresses);
+
+	if (m_socket < 0)
+	{
+		std::cout << "Unable to bind to " << m_hostName << ":" << m_port << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	// wake up regularly so a stop request is noticed even when no data arrives
+	timeval timeout;
+	timeout.tv_sec = 0;
+	timeout.tv_usec = RECEIVETIMEOUT_MS * 1000;
+	setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+#if defined(__linux__)
+	int enable = 1;
+	if (m_kernelTimestamps && setsockopt(m_socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) != 0)
+	{
+		std::cout << "Unable to enable kernel receive timestamps: " << strerror(errno) << std::endl;
+		m_kernelTimestamps = false;
+	}
+#endif
+
+	return true;
 }
+#endif
+
+/*! Receive datagrams from the socket and queue them for the processing thread
 
+	This runs on its own thread and never parses, it only moves datagrams from the socket into the ring.
+*/
 void UdpServer::readMessages()
 {
-	XsByteArray buffer;
+	// datagrams that arrive while the ring is full are read into this buffer and dropped
+	std::vector<uint8_t> overflow(m_ring->slotSize());
+
+#if defined(__linux__)
+	std::vector<iovec> iovecs(m_batchSize);
+	std::vector<mmsghdr> messages(m_batchSize);
+
+	// room for the SCM_TIMESTAMPNS control message of every datagram in a batch
+	const size_t controlSize = CMSG_SPACE(sizeof(timespec));
+	std::vector<uint64_t> controls(m_kernelTimestamps ? (m_batchSize * controlSize + 7) / 8 : 0);
+
+	for (int i = 0; i < m_batchSize; i++)
+	{
+		iovecs[i].iov_len = m_ring->slotSize();
+		memset(&messages[i], 0, sizeof(mmsghdr));
+		messages[i].msg_hdr.msg_iov = &iovecs[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+		if (m_kernelTimestamps)
+			messages[i].msg_hdr.msg_control = (uint8_t*)controls.data() + i * controlSize;
+	}
+#endif
 
 	std::cout << "Waiting to receive packets from the client ..." << std::endl << std::endl;
 
 	while (!m_stopping)
 	{
-		int rv = m_socket->read(buffer);
-		if (buffer.size() > 0)
-			m_parserManager->readDatagram(buffer);
+		if (m_ring->freeSlots() == 0)
+		{
+#ifdef _WIN32
+			int rv = m_socket->read(overflow.data(), overflow.size());
+			bool truncated = false;
+			double timestamp = lsl::local_clock();
+#elif defined(__linux__)
+			// read like a slot, so the capture gets the same timestamp and truncation check as the ring
+			iovecs[0].iov_base = overflow.data();
+			messages[0].msg_hdr.msg_controllen = m_kernelTimestamps ? controlSize : 0;
+			ssize_t rv = recvmsg(m_socket, &messages[0].msg_hdr, 0);
+			bool truncated = (messages[0].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+			double timestamp = lsl::local_clock();
+			if (rv > 0 && m_kernelTimestamps)
+			{
+				timespec realNow;
+				clock_gettime(CLOCK_REALTIME, &realNow);
+				timestamp = kernelTimestamp(messages[0].msg_hdr, timestamp, realNow);
+			}
+#else
+			ssize_t rv = recv(m_socket, overflow.data(), overflow.size(), 0);
+			bool truncated = false;
+			double timestamp = lsl::local_clock();
+#endif
+			if (rv > 0)
+			{
+				// the capture still records what the ring had no room for
+				if (m_capture && truncated)
+					m_capture->drop();
+				else if (m_capture)
+					m_capture->append(overflow.data(), (size_t)rv, timestamp);
+				m_ring->drop();
+			}
+			continue;
+		}
+
+		// the datagrams are received straight into the free slots of the ring
+#ifdef _WIN32
+		// a slot sized read also avoids the size probe of XsSocket::read(XsByteArray&)
+		int rv = m_socket->read(m_ring->writeSlot(0), m_ring->slotSize());
+		if (rv > 0)
+		{
+			double now = lsl::local_clock();
+			m_ring->setSize(0, (size_t)rv);
+			m_ring->setTimestamp(0, now);
+			if (m_capture)
+				m_capture->append(m_ring->writeSlot(0), (size_t)rv, now);
+			m_ring->push(1);
+		}
+#elif defined(__linux__)
+		// block until the first datagram arrives, then drain whatever else is queued up to the batch size
+		int count = (int)std::min(m_ring->freeSlots(), (size_t)m_batchSize);
+		for (int i = 0; i < count; i++)
+		{
+			iovecs[i].iov_base = m_ring->writeSlot(i);
+			// the kernel shrinks the control length to what it wrote
+			messages[i].msg_hdr.msg_controllen = m_kernelTimestamps ? controlSize : 0;
+		}
 
-		buffer.clear();
+		// with MSG_TRUNC the length of a datagram that did not fit in its slot is its full size
+		int rv = recvmmsg(m_socket, messages.data(), count, MSG_WAITFORONE | MSG_TRUNC, nullptr);
+		if (rv > 0)
+		{
+			// without kernel timestamps the datagrams of a batch all get the time the call returned
+			double now = lsl::local_clock();
+			timespec realNow;
+			if (m_kernelTimestamps)
+				clock_gettime(CLOCK_REALTIME, &realNow);
+
+			// datagrams that did not fit in a slot are incomplete, they are published empty and skipped by the
+			// parser, and counted as dropped by the capture
+			for (int i = 0; i < rv; i++)
+			{
+				size_t size = messages[i].msg_len;
+				bool truncated = (messages[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+				if (truncated)
+				{
+					if (m_truncatedCount.load(std::memory_order_relaxed) == 0)
+						std::cout << "Received a datagram of " << size << " bytes, datagrams larger than "
+							<< m_ring->slotSize() << " bytes are dropped" << std::endl;
+					m_truncatedCount.store(m_truncatedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					size = 0;
+				}
+				double timestamp = m_kernelTimestamps ? kernelTimestamp(messages[i].msg_hdr, now, realNow) : now;
+				m_ring->setSize(i, size);
+				m_ring->setTimestamp(i, timestamp);
+				if (m_capture && truncated)
+					m_capture->drop();
+				else if (m_capture)
+					m_capture->append(m_ring->writeSlot(i), size, timestamp);
+			}
+			m_ring->push(rv);
+		}
+#else
+		ssize_t rv = recv(m_socket, m_ring->writeSlot(0), m_ring->slotSize(), 0);
+		if (rv > 0)
+		{
+			double now = lsl::local_clock();
+			m_ring->setSize(0, (size_t)rv);
+			m_ring->setTimestamp(0, now);
+			if (m_capture)
+				m_capture->append(m_ring->writeSlot(0), (size_t)rv, now);
+			m_ring->push(1);
+		}
+#endif
 	}
 
 	std::cout << "Stopping receiving packets..." << std::endl << std::endl;
+}
 
-	m_stopping = false;
-	m_started = false;
+#if defined(__linux__)
+/*! Convert the kernel receive timestamp of a datagram to the lsl::local_clock() domain
+
+	The kernel stamps datagrams with CLOCK_REALTIME, so the time the datagram waited in the socket is the
+	distance to \a realNow, which was read right after \a now. A datagram without a timestamp or one from
+	after a step of the wall clock gets \a now.
+
+	\returns The time the kernel received the datagram in seconds
+*/
+double UdpServer::kernelTimestamp(const msghdr& message, double now, const timespec& realNow)
+{
+	for (const cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&message), const_cast<cmsghdr*>(cmsg)))
+	{
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPNS)
+			continue;
+
+		timespec received;
+		memcpy(&received, CMSG_DATA(cmsg), sizeof(received));
+		int64_t latency = (int64_t)(realNow.tv_sec - received.tv_sec) * 1000000000 + (realNow.tv_nsec - received.tv_nsec);
+		if (latency < 0)
+			return now;
+
+		m_kernelLatencyTotal += (uint64_t)latency;
+		m_kernelLatencyCount++;
+		uint64_t max = m_kernelLatencyMax;
+		while ((uint64_t)latency > max && !m_kernelLatencyMax.compare_exchange_weak(max, (uint64_t)latency))
+			;
+
+		return now - latency * 1e-9;
+	}
+	return now;
+}
+#endif
+
+/*! Parse the datagrams queued by the receive thread and push them to LSL
+
+	This runs on its own thread, so a stall inside liblsl does not delay the next socket read.
+*/
+void UdpServer::processMessages()
+{
+	int idle = 0;
+
+	while (!m_stopping)
+	{
+		// checked before every batch, so a stream that stopped sending still gets its last chunk out in time
+		// while the other streams keep the queue busy
+		m_parserManager->flushExpired(lsl::local_clock());
+
+		if (m_ring->usedSlots() == 0)
+		{
+			if (++idle < PROCESSINGSPINCOUNT)
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for(std::chrono::microseconds(PROCESSINGIDLE_US));
+			continue;
+		}
+
+		idle = 0;
+		m_parserManager->readDatagrams(*m_ring);
+	}
+}
+
+/*! The highest number of datagrams that were queued between the receive and the processing thread */
+size_t UdpServer::queueHighWaterMark() const
+{
+	return m_ring->highWaterMark();
+}
+
+/*! The number of datagrams dropped because the queue between the receive and the processing thread was full */
+size_t UdpServer::queueOverflowCount() const
+{
+	return m_ring->overflowCount();
+}
+
+/*! The number of datagrams dropped because they were malformed or truncated */
+size_t UdpServer::malformedCount() const
+{
+	return m_parserManager->malformedCount();
+}
+
+/*! The number of datagrams dropped because they were larger than a slot of the queue
+
+	Only Linux detects these, other platforms pass the truncated datagram on to the parser.
+*/
+size_t UdpServer::truncatedCount() const
+{
+	return m_truncatedCount.load(std::memory_order_relaxed);
+}
+
+/*! The mean time in seconds between the kernel receiving a datagram and the receive thread reading it
+
+	This is only measured with kernel timestamps enabled, otherwise it is 0.
+*/
+double UdpServer::kernelLatencyMean() const
+{
+	size_t count = m_kernelLatencyCount;
+	return count ? m_kernelLatencyTotal * 1e-9 / count : 0.0;
+}
+
+/*! The longest time in seconds between the kernel receiving a datagram and the receive thread reading it */
+double UdpServer::kernelLatencyMax() const
+{
+	return m_kernelLatencyMax * 1e-9;
+}
+
+/*! Print the latency percentiles of every stage between the socket and LSL, if they are measured
+
+	This can be called from any thread while the server is running.
+*/
+void UdpServer::printLatency() const
+{
+	const PipelineLatency *latency = m_parserManager->latency();
+	if (latency)
+		latency->print(std::cout);
 }
 
 void UdpServer::startThread()
@@ -82,14 +460,69 @@ void UdpServer::startThread()
 
 	m_started = true;
 	m_stopping = false;
-	xsStartThread(udpThreadFunc, this, 0);
+	m_receiveThread = std::thread(&UdpServer::readMessages, this);
+	m_processingThread = std::thread(&UdpServer::processMessages, this);
 }
 
 void UdpServer::stopThread()
 {
 	if (!m_started)
 		return;
+
 	m_stopping = true;
-	while (m_started)
-		XsTime::msleep(10);
+	m_receiveThread.join();
+	m_processingThread.join();
+
+	std::cout << "Queue high-water mark: " << queueHighWaterMark() << " datagrams, "
+		<< "overflow drops: " << queueOverflowCount() << ", "
+		<< "malformed drops: " << malformedCount() << ", "
+		<< "oversized drops: " << truncatedCount() << std::endl;
+
+	if (m_capture)
+	{
+		m_capture->close();
+		std::cout << "Captured " << m_capture->recordCount() << " datagrams to " << m_capture->path()
+			<< ", capture drops: " << m_capture->droppedCount() << std::endl;
+	}
+
+	const SequenceTracker &sequence = m_parserManager->sequenceTracker();
+	std::cout << "Sample counters in order: " << sequence.inOrderCount() << ", "
+		<< "gaps: " << sequence.gapCount() << " (" << sequence.missedCount() << " samples missed), "
+		<< "late: " << sequence.lateCount() << ", duplicates: " << sequence.duplicateCount() << ", "
+		<< "resyncs: " << sequence.resyncCount() << std::endl;
+
+	const JitterStatistics &jitter = m_parserManager->jitterStatistics();
+	if (jitter.delay.load(std::memory_order_relaxed))
+		std::cout << "Jitter buffer depth: " << jitter.depth.load(std::memory_order_relaxed) << " samples, "
+			<< "delay: " << jitter.delay.load(std::memory_order_relaxed) * 1e-3 << " ms, "
+			<< "underruns: " << jitter.underrunCount.load(std::memory_order_relaxed) << ", "
+			<< "overruns: " << jitter.overrunCount.load(std::memory_order_relaxed) << std::endl;
+
+	const FrameReassembler &reassembler = m_parserManager->frameReassembler();
+	if (reassembler.completedCount() || reassembler.expiredCount())
+		std::cout << "Reassembled split frames: " << reassembler.completedCount() << ", "
+			<< "incomplete drops: " << reassembler.expiredCount() << std::endl;
+
+	const FrameAggregator &aggregator = m_parserManager->frameAggregator();
+	if (aggregator.completeCount() || aggregator.partialCount() || aggregator.lateCount())
+		std::cout << "Combined frames: " << aggregator.completeCount() << ", "
+			<< "with missing types: " << aggregator.partialCount() << ", "
+			<< "late drops: " << aggregator.lateCount() << std::endl;
+
+	if (m_kernelLatencyCount)
+		std::cout << "Kernel to receive thread latency mean: " << kernelLatencyMean() * 1e6 << " us, "
+			<< "max: " << kernelLatencyMax() * 1e6 << " us" << std::endl;
+
+	printLatency();
+
+	for (int avatarId = 0; avatarId < 256; avatarId++)
+	{
+		const SenderClock &clock = m_parserManager->senderClock((uint8_t)avatarId);
+		if (clock.isLocked())
+			std::cout << "Avatar " << avatarId + 1 << " clock drift: " << clock.drift() * 1e6 << " ppm, "
+				<< "outliers: " << clock.outlierCount() << ", resets: " << clock.resetCount() << std::endl;
+	}
+
+	m_stopping = false;
+	m_started = false;
 }
@@ -28,28 +28,71 @@
 #define UDPSERVER_H
 
 #include "streamer.h"
+#include "capturefile.h"
 #include "parsermanager.h"
+#include "packetring.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
 #include <xsens/xssocket.h>
-#include <xsens/xsthread.h>
+#endif
 
 class UdpServer
 {
 public:
-	UdpServer(XsString address = "localhost", uint16_t port = 9763);
+	UdpServer(const std::string& address = "localhost", uint16_t port = 9763, int batchSize = 32,
+		const ChunkPolicies& chunkPolicies = ChunkPolicies(), bool kernelTimestamps = false,
+		const AggregationPolicy& aggregationPolicy = AggregationPolicy(),
+		const SequencePolicy& sequencePolicy = SequencePolicy(), const JitterPolicy& jitterPolicy = JitterPolicy(),
+		bool measureLatency = false, const std::string& capturePath = std::string());
 	~UdpServer();
 	
 	void readMessages();
+	void processMessages();
 	void startThread();
 	void stopThread();
 
+	size_t queueHighWaterMark() const;
+	size_t queueOverflowCount() const;
+	size_t malformedCount() const;
+	size_t truncatedCount() const;
+	double kernelLatencyMean() const;
+	double kernelLatencyMax() const;
+	void printLatency() const;
+
 private:
+#ifdef _WIN32
 	std::unique_ptr<XsSocket> m_socket;
+#else
+	bool bind();
+#if defined(__linux__)
+	double kernelTimestamp(const struct msghdr& message, double now, const struct timespec& realNow);
+#endif
+
+	int m_socket;
+#endif
+	std::thread m_receiveThread;
+	std::thread m_processingThread;
 	uint16_t m_port;
-	XsString m_hostName;
+	std::string m_hostName;
+	int m_batchSize;
+	bool m_kernelTimestamps;
+
+	// the time datagrams spent between the kernel receive timestamp and the receive thread, in nanoseconds
+	std::atomic<uint64_t> m_kernelLatencyTotal;
+	std::atomic<uint64_t> m_kernelLatencyMax;
+	std::atomic<size_t> m_kernelLatencyCount;
+
+	// datagrams larger than a ring slot, they are published empty and not parsed
+	std::atomic<size_t> m_truncatedCount;
 
 	std::unique_ptr<ParserManager> m_parserManager;
+	std::unique_ptr<PacketRing> m_ring;
+	std::unique_ptr<CaptureWriter> m_capture;
 
-	volatile bool m_started, m_stopping;
+	std::atomic<bool> m_started, m_stopping;
 
 };
 
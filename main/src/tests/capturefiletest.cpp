@@ -0,0 +1,161 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*! \file
+	\brief Regression tests of CaptureWriter and CaptureReader
+
+	A capture must read back every datagram it recorded, in order and unchanged, also across the segments of the
+	file, and the index must find them by receive time and sample counter. Datagrams that are not recorded are
+	counted as dropped.
+*/
+
+#include "capturefile.h"
+#include "datagramheader.h"
+#include "testsupport.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+static const char *PATH = "capturefiletest.capture";
+
+// about 4 MB of datagrams, so the capture spans several segments of the smallest size
+static const int DATAGRAMCOUNT = 5000;
+static const size_t SEGMENTSIZE = 1024 * 1024;
+
+/*! \returns the quaternion datagram with sample counter \a sampleCounter, of 200 to 1499 bytes */
+static std::vector<uint8_t> datagram(int sampleCounter)
+{
+	std::vector<uint8_t> packet;
+	PacketWriter writer(packet);
+	writer.header(0x02, sampleCounter, 0x80, 1, sampleCounter, 0);
+	packet.resize(200 + (size_t)(sampleCounter * 7919) % 1300);
+	for (size_t i = PacketWriter::HEADERSIZE; i < packet.size(); i++)
+		packet[i] = (uint8_t)(i + sampleCounter);
+	return packet;
+}
+
+/*! \returns the receive time of the datagram with \a sampleCounter, 1 ms apart */
+static double receiveTime(int sampleCounter)
+{
+	return 100.0 + sampleCounter * 0.001;
+}
+
+/*! Capture DATAGRAMCOUNT datagrams to PATH */
+static void writeCapture()
+{
+	CaptureWriter writer(PATH, SEGMENTSIZE);
+	CHECK(writer.isOpen());
+
+	for (int i = 0; i < DATAGRAMCOUNT; i++)
+	{
+		std::vector<uint8_t> packet = datagram(i);
+		writer.append(packet.data(), packet.size(), receiveTime(i));
+
+		// give the background thread time to map the next segment, the writer never waits for it
+		if (i % 100 == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	// empty datagrams are not recorded, and a datagram that was not received whole is only counted
+	writer.append(nullptr, 0, receiveTime(DATAGRAMCOUNT));
+	writer.drop();
+	writer.close();
+
+	CHECK(writer.recordCount() == (size_t)DATAGRAMCOUNT);
+	CHECK(writer.droppedCount() == 1);
+}
+
+static void testRoundTrip()
+{
+	CaptureReader reader(PATH);
+	CHECK(reader.isOpen());
+
+	// an index entry every 100 ms of the 5 s of datagrams
+	CHECK(reader.index().size() == 50);
+
+	uint64_t offset = reader.firstRecord();
+	CaptureReader::Record record;
+	int count = 0;
+	while (reader.read(offset, record))
+	{
+		if (record.data != datagram(count) || record.time != receiveTime(count))
+		{
+			CHECK(record.data == datagram(count));
+			CHECK(record.time == receiveTime(count));
+			break;
+		}
+		count++;
+	}
+	CHECK(count == DATAGRAMCOUNT);
+
+	// the records span several segments
+	CHECK(offset > 3 * SEGMENTSIZE);
+}
+
+static void testFind()
+{
+	CaptureReader reader(PATH);
+	CaptureReader::Record record;
+
+	for (int sampleCounter : { 0, 1, 99, 100, 2345, DATAGRAMCOUNT - 1 })
+	{
+		uint64_t offset = reader.findSampleCounter(sampleCounter);
+		CHECK(reader.read(offset, record));
+		CHECK(DatagramHeader(record.data.data(), record.data.size()).sampleCounter() == sampleCounter);
+	}
+
+	// a time between two datagrams finds the later one
+	for (int sampleCounter : { 0, 150, 3001, DATAGRAMCOUNT - 1 })
+	{
+		uint64_t offset = reader.findTime(receiveTime(sampleCounter) - 0.0005);
+		CHECK(reader.read(offset, record));
+		CHECK(record.time == receiveTime(sampleCounter));
+	}
+
+	// past the last datagram nothing is found
+	uint64_t offset = reader.findSampleCounter(DATAGRAMCOUNT);
+	CHECK(!reader.read(offset, record));
+	offset = reader.findTime(receiveTime(DATAGRAMCOUNT));
+	CHECK(!reader.read(offset, record));
+}
+
+static void testNotACapture()
+{
+	CHECK(!CaptureReader("capturefiletest.missing").isOpen());
+}
+
+int main()
+{
+	writeCapture();
+	testRoundTrip();
+	testFind();
+	testNotACapture();
+	std::remove(PATH);
+
+	return testResult();
+}
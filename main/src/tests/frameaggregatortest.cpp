@@ -0,0 +1,124 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*! \file
+	\brief Regression tests of FrameAggregator
+
+	The combined outlet must never go back in time: a frame older than the last pushed one is late, and an older
+	frame that is still open is pushed before a newer one.
+*/
+
+#include "frameaggregator.h"
+#include "testsupport.h"
+
+#include <vector>
+
+static const int QUATERNION = 0x02;
+static const int LINEAR = 0x21;
+
+/*! Combines the quaternion and linear kinematics types, with a wait long enough to never expire */
+static AggregationPolicy policy()
+{
+	AggregationPolicy policy;
+	policy.types = { QUATERNION, LINEAR };
+	policy.milliseconds = 10000;
+	return policy;
+}
+
+/*! Add the part of \a type of frame \a sampleCounter of avatar 0 */
+static void add(FrameAggregator &aggregator, int type, int32_t sampleCounter)
+{
+	std::vector<float> values(type == QUATERNION ? 7 : 9, (float)sampleCounter);
+	double time = sampleCounter * 0.01;
+	aggregator.add(0, type, sampleCounter, values.data(), values.size(), time, time);
+}
+
+static void testOlderFrameAfterNewerIsLate()
+{
+	FrameAggregator aggregator(policy());
+	add(aggregator, QUATERNION, 101);
+	add(aggregator, LINEAR, 101);
+	CHECK(aggregator.completeCount() == 1);
+
+	add(aggregator, QUATERNION, 100);
+	add(aggregator, LINEAR, 100);
+	CHECK(aggregator.lateCount() == 2);
+	CHECK(aggregator.completeCount() == 1);
+	CHECK(aggregator.partialCount() == 0);
+
+	// the frame that was pushed is late as well
+	add(aggregator, QUATERNION, 101);
+	CHECK(aggregator.lateCount() == 3);
+}
+
+static void testOpenOlderFrameIsPushedFirst()
+{
+	FrameAggregator aggregator(policy());
+	add(aggregator, QUATERNION, 100);
+	add(aggregator, QUATERNION, 101);
+	add(aggregator, LINEAR, 101);
+
+	// frame 101 completed while 100 was open, so 100 went out first without its linear part
+	CHECK(aggregator.partialCount() == 1);
+	CHECK(aggregator.completeCount() == 1);
+
+	add(aggregator, LINEAR, 100);
+	CHECK(aggregator.lateCount() == 1);
+}
+
+static void testOutOfOrderFramesWithinWindow()
+{
+	FrameAggregator aggregator(policy());
+	add(aggregator, QUATERNION, 101);
+	add(aggregator, QUATERNION, 100);
+	add(aggregator, LINEAR, 100);
+	add(aggregator, LINEAR, 101);
+
+	CHECK(aggregator.completeCount() == 2);
+	CHECK(aggregator.lateCount() == 0);
+}
+
+static void testSenderRestart()
+{
+	FrameAggregator aggregator(policy());
+	add(aggregator, QUATERNION, 5000);
+	add(aggregator, LINEAR, 5000);
+
+	add(aggregator, QUATERNION, 3);
+	add(aggregator, LINEAR, 3);
+	CHECK(aggregator.completeCount() == 2);
+	CHECK(aggregator.lateCount() == 0);
+}
+
+int main()
+{
+	testOlderFrameAfterNewerIsLate();
+	testOpenOlderFrameIsPushedFirst();
+	testOutOfOrderFramesWithinWindow();
+	testSenderRestart();
+
+	return testResult();
+}
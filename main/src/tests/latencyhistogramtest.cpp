@@ -0,0 +1,121 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*! \file
+	\brief Regression tests of LatencyHistogram and PipelineLatency
+
+	The queue and total stages of a datagram must not depend on how long the bridge has been running, the tick
+	rate is only calibrated once and a small error in it grows with the uptime when ticks are mapped to the
+	local clock.
+*/
+
+#include "latencyhistogram.h"
+#include "testsupport.h"
+
+#include <chrono>
+#include <thread>
+
+static const int QUATERNION = 0x02;
+
+/*! \returns true if \a value is within the 1/8 bucket error of \a expected */
+static bool isNear(int64_t value, int64_t expected)
+{
+	return value >= expected - expected / 8 - 1 && value <= expected + expected / 8 + 1;
+}
+
+static void testPercentiles()
+{
+	LatencyHistogram histogram;
+	CHECK(histogram.count() == 0);
+	CHECK(histogram.percentile(50) == 0);
+
+	for (int64_t value = 1; value <= 1000; value++)
+		histogram.record(value * 1000);
+	CHECK(histogram.count() == 1000);
+	CHECK(histogram.max() == 1000000);
+	CHECK(isNear(histogram.percentile(50), 500000));
+	CHECK(isNear(histogram.percentile(99), 990000));
+	CHECK(histogram.percentile(100) == 1000000);
+
+	histogram.record(-5);
+	CHECK(histogram.count() == 1001);
+}
+
+static void testQueueDoesNotDriftWithUptime()
+{
+	PipelineLatency latency;
+
+	// a day of datagrams at 1 Hz that waited 20 us in the queue, the stages after it take no time
+	const int64_t queue = 20000;
+	for (int second = 0; second < 24 * 3600; second++)
+	{
+		double receiveTime = 1000.0 + second;
+		int64_t begin = PipelineLatency::ticks();
+		latency.record(QUATERNION, receiveTime, receiveTime + queue * 1e-9, begin, begin, begin);
+	}
+
+	const LatencyHistogram *queueHistogram = latency.histogram(QUATERNION, PipelineLatency::Queue);
+	const LatencyHistogram *totalHistogram = latency.histogram(QUATERNION, PipelineLatency::Total);
+	CHECK(queueHistogram && totalHistogram);
+	if (!queueHistogram || !totalHistogram)
+		return;
+
+	CHECK(queueHistogram->count() == 24 * 3600);
+	CHECK(isNear(queueHistogram->percentile(0.1), queue));
+	CHECK(isNear(queueHistogram->max(), queue));
+	CHECK(isNear(totalHistogram->percentile(0.1), queue));
+	CHECK(isNear(totalHistogram->max(), queue));
+}
+
+static void testStagesAfterTheQueueUseTheTicks()
+{
+	PipelineLatency latency;
+
+	int64_t begin = PipelineLatency::ticks();
+	std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	int64_t parsed = PipelineLatency::ticks();
+	latency.record(QUATERNION, 5.0, 5.0, begin, parsed, parsed);
+
+	const LatencyHistogram *parse = latency.histogram(QUATERNION, PipelineLatency::Parse);
+	const LatencyHistogram *total = latency.histogram(QUATERNION, PipelineLatency::Total);
+	CHECK(parse && total);
+	if (!parse || !total)
+		return;
+
+	// sleeping may take longer, but never shorter
+	CHECK(parse->max() >= 1750000 && parse->max() < 1000000000);
+	CHECK(isNear(total->max(), parse->max()));
+	CHECK(latency.histogram(QUATERNION + 1, PipelineLatency::Parse) == nullptr);
+}
+
+int main()
+{
+	testPercentiles();
+	testQueueDoesNotDriftWithUptime();
+	testStagesAfterTheQueueUseTheTicks();
+
+	return testResult();
+}
@@ -0,0 +1,131 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*! \file
+	\brief Regression tests of ScaleDatagram
+
+	MVN Studio interleaves the null pose packet, which names the segments, with point definition packets of 0
+	segments. Only a change of the segment names may bump the avatar revision, as that re-creates the outlets.
+*/
+
+#include "avatarinfo.h"
+#include "scaledatagram.h"
+#include "testsupport.h"
+
+#include <string>
+#include <vector>
+
+/*! \returns a scale packet of avatar 0 with its header */
+static std::vector<uint8_t> scaleHeader()
+{
+	std::vector<uint8_t> packet;
+	PacketWriter(packet).header(SPMetaScaling, 1, 0x80, 1, 0, 0);
+	return packet;
+}
+
+/*! \returns the null pose packet that names \a segments */
+static std::vector<uint8_t> nullPosePacket(const std::vector<std::string> &segments)
+{
+	std::vector<uint8_t> packet = scaleHeader();
+	PacketWriter writer(packet);
+	writer.int32((int32_t)segments.size());
+	for (const std::string &segment : segments)
+	{
+		writer.string(segment);
+		for (int i = 0; i < 3; i++)
+			writer.float32(0.5f);
+	}
+	return packet;
+}
+
+/*! \returns a point definition packet of 0 segments with \a points points */
+static std::vector<uint8_t> pointDefinitionPacket(int points)
+{
+	std::vector<uint8_t> packet = scaleHeader();
+	PacketWriter writer(packet);
+	writer.int32(0);
+	writer.int32(points);
+	for (int i = 0; i < points; i++)
+	{
+		writer.int16(1);
+		writer.int16((int16_t)i);
+		writer.string("pPoint" + std::to_string(i));
+		writer.int32(0);
+		for (int j = 0; j < 3; j++)
+			writer.float32(0.1f);
+	}
+	return packet;
+}
+
+static void testPointDefinitionsKeepSegmentNames()
+{
+	AvatarInfoTable avatars;
+	ScaleDatagram datagram;
+	datagram.setAvatarInfo(&avatars);
+
+	std::vector<std::string> segments = { "Pelvis", "L5", "L3" };
+	std::vector<uint8_t> nullPose = nullPosePacket(segments);
+	CHECK(datagram.deserialize(nullPose.data(), nullPose.size()));
+	unsigned int revision = avatars.info(0).revision;
+	CHECK(avatars.info(0).segmentNames == segments);
+
+	std::vector<uint8_t> points = pointDefinitionPacket(2);
+	CHECK(datagram.deserialize(points.data(), points.size()));
+	CHECK(avatars.info(0).revision == revision);
+	CHECK(avatars.info(0).segmentNames == segments);
+
+	std::vector<uint8_t> lastPoints = pointDefinitionPacket(0);
+	CHECK(datagram.deserialize(lastPoints.data(), lastPoints.size()));
+	CHECK(avatars.info(0).revision == revision);
+
+	// the same names again are no change either
+	CHECK(datagram.deserialize(nullPose.data(), nullPose.size()));
+	CHECK(avatars.info(0).revision == revision);
+}
+
+static void testNewSegmentNamesBumpRevision()
+{
+	AvatarInfoTable avatars;
+	ScaleDatagram datagram;
+	datagram.setAvatarInfo(&avatars);
+
+	std::vector<uint8_t> first = nullPosePacket({ "Pelvis", "L5" });
+	CHECK(datagram.deserialize(first.data(), first.size()));
+	unsigned int revision = avatars.info(0).revision;
+
+	std::vector<uint8_t> second = nullPosePacket({ "Pelvis", "L5", "L3" });
+	CHECK(datagram.deserialize(second.data(), second.size()));
+	CHECK(avatars.info(0).revision == revision + 1);
+	CHECK(avatars.info(0).segmentNames.size() == 3);
+}
+
+int main()
+{
+	testPointDefinitionsKeepSegmentNames();
+	testNewSegmentNamesBumpRevision();
+
+	return testResult();
+}
@@ -0,0 +1,117 @@
+/*! \file
+	\section FileCopyright Copyright Notice
+	This is free and unencumbered software released into the public domain.
+
+	Anyone is free to copy, modify, publish, use, compile, sell, or
+	distribute this software, either in source code form or as a compiled
+	binary, for any purpose, commercial or non-commercial, and by any
+	means.
+
+	In jurisdictions that recognize copyright laws, the author or authors
+	of this software dedicate any and all copyright interest in the
+	software to the public domain. We make this dedication for the benefit
+	of the public at large and to the detriment of our heirs and
+	successors. We intend this dedication to be an overt act of
+	relinquishment in perpetuity of all present and future rights to this
+	software under copyright law.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+	OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+	OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*! \file
+	\brief What the tests, the generator and the benchmarks share to build packets and check results
+*/
+
+#ifndef TESTSUPPORT_H
+#define TESTSUPPORT_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*! Appends big endian fields to a packet */
+class PacketWriter
+{
+public:
+	// the size of the header of every datagram
+	static const size_t HEADERSIZE = 24;
+
+	explicit PacketWriter(std::vector<uint8_t> &packet) : m_packet(packet) {}
+
+	/*! Replace the packet by the header of a datagram of \a type, with zeroed reserved bytes */
+	void header(int type, int32_t sampleCounter, uint8_t datagramCounter, uint8_t dataCount, int32_t frameTime,
+		uint8_t avatarId)
+	{
+		static const char HEXDIGITS[] = "0123456789ABCDEF";
+		const char id[6] = { 'M', 'X', 'T', 'P', HEXDIGITS[(type >> 4) & 0xF], HEXDIGITS[type & 0xF] };
+
+		m_packet.assign(id, id + sizeof(id));
+		int32(sampleCounter);
+		int8(datagramCounter);
+		int8(dataCount);
+		int32(frameTime);
+		int8(avatarId);
+		m_packet.resize(HEADERSIZE, 0);
+	}
+
+	void int8(uint8_t value) { m_packet.push_back(value); }
+	void int16(int16_t value)
+	{
+		m_packet.push_back((uint8_t)((uint16_t)value >> 8));
+		m_packet.push_back((uint8_t)value);
+	}
+	void int32(int32_t value)
+	{
+		uint32_t v = (uint32_t)value;
+		uint8_t bytes[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+		m_packet.insert(m_packet.end(), bytes, bytes + 4);
+	}
+	void float32(float value)
+	{
+		int32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		int32(bits);
+	}
+	void string(const std::string &value)
+	{
+		int32((int32_t)value.size());
+		m_packet.insert(m_packet.end(), value.begin(), value.end());
+	}
+
+private:
+	std::vector<uint8_t> &m_packet;
+};
+
+/*! \returns the number of failed checks of the test */
+inline int &testFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+			testFailures()++; \
+		} \
+	} while (false)
+
+/*! Report the failed checks, \returns the exit code of the test */
+inline int testResult()
+{
+	if (testFailures())
+		std::cout << testFailures() << " checks failed" << std::endl;
+	return testFailures() ? 1 : 0;
+}
+
+#endif